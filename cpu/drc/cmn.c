@@ -6,6 +6,11 @@
  * See COPYING file in the top-level directory.
  */
 #include <stdio.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 #include <pico/pico_int.h>
 #include "cmn.h"
@@ -18,18 +23,68 @@
 #endif
 u8 ALIGNED(PICO_PAGE_ALIGN) tcache_default[DRC_TCACHE_SIZE];
 u8 *tcache;
+uptr tcache_rw_offs;
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+// W^X: back tcache with a memfd, replace the original region with an RX view
+// of it (keeping the address, and so branch ranges to the emulator code), and
+// add an RW view somewhere else for the emitters.
+static int tcache_dual_map(void)
+{
+  static void *rx, *rw;
+  int fd;
+
+  if (rx == tcache && rw != NULL)
+    goto done;
+
+  fd = syscall(SYS_memfd_create, "picodrive-tcache", 0);
+  if (fd < 0)
+    return -1;
+  if (ftruncate(fd, DRC_TCACHE_SIZE) != 0)
+    goto fail;
+
+  rw = mmap(NULL, DRC_TCACHE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (rw == MAP_FAILED)
+    goto fail;
+  rx = mmap(tcache, DRC_TCACHE_SIZE, PROT_READ | PROT_EXEC,
+            MAP_SHARED | MAP_FIXED, fd, 0);
+  if (rx != tcache) {
+    munmap(rw, DRC_TCACHE_SIZE);
+    rx = rw = NULL;
+    goto fail;
+  }
+  close(fd);
+
+done:
+  tcache_rw_offs = (uptr)rw - (uptr)rx;
+  return 0;
+
+fail:
+  close(fd);
+  return -1;
+}
+#else
+static int tcache_dual_map(void)
+{
+  return -1;
+}
+#endif
 
 void drc_cmn_init(void)
 {
   int ret;
 
+  tcache_rw_offs = 0;
+
   tcache = plat_mem_get_for_drc(DRC_TCACHE_SIZE);
   if (tcache == NULL)
     tcache = tcache_default;
 
   ret = plat_mem_set_exec(tcache, DRC_TCACHE_SIZE);
-  elprintf(EL_STATUS, "drc_cmn_init: %p, %zd bytes: %d",
-    tcache, DRC_TCACHE_SIZE, ret);
+  if (ret != 0 && tcache_dual_map() == 0)
+    ret = 0;
+  elprintf(EL_STATUS, "drc_cmn_init: %p, %zd bytes: %d, rw offset %lx",
+    tcache, DRC_TCACHE_SIZE, ret, (ulong)tcache_rw_offs);
 
 #ifdef __arm__
   if (PicoIn.opt & POPT_EN_DRC)
@@ -37,13 +92,13 @@ void drc_cmn_init(void)
     static int test_done;
     if (!test_done)
     {
-      int *test_out = (void *)tcache;
+      int *test_out = TCACHE_RW(tcache);
       int (*testfunc)(void) = (void *)tcache;
 
       elprintf(EL_STATUS, "testing if we can run recompiled code..");
       *test_out++ = 0xe3a000dd; // mov r0, 0xdd
       *test_out++ = 0xe12fff1e; // bx lr
-      cache_flush_d_inval_i(tcache, test_out);
+      cache_flush_d_inval_i(tcache, (u8 *)test_out - tcache_rw_offs);
 
       // we'll usually crash on broken platforms or bad ports,
       // but do a value check too just in case
@@ -3,6 +3,11 @@
 
 extern u8 *tcache;
 
+// tcache is where the code runs from; if the platform refuses RWX memory it
+// is mapped a 2nd time writable elsewhere, and all stores must go there.
+extern uptr tcache_rw_offs;
+#define TCACHE_RW(p) ((void *)((u8 *)(p) + tcache_rw_offs))
+
 void drc_cmn_init(void);
 void drc_cmn_cleanup(void);
 
@@ -293,7 +293,7 @@ enum { RB_SRL=0, RB_ROTR=1 };
 // XXX: tcache_ptr type for SVP and SH2 compilers differs..
 #define EMIT_PTR(ptr, x) \
 	do { \
-		*(u32 *)(ptr) = x; \
+		*(u32 *)TCACHE_RW(ptr) = x; \
 		ptr = (void *)((u8 *)(ptr) + sizeof(u32)); \
 	} while (0)
 
@@ -844,10 +844,10 @@ static void emith_pool_commit(int jumpover)
 		exit(1);
 	}
 	// copy pool and adjust addresses in insns accessing the pool
-	memcpy(pool, literal_pool, sz);
+	memcpy(TCACHE_RW(pool), literal_pool, sz);
 	for (i = 0; i < literal_iindex; i++) {
 		u32 *pi = literal_insn[i];
-		*pi = (*pi & 0xffff0000) | (u16)(*pi + ((u8 *)pool - (u8 *)pi));
+		*(u32 *)TCACHE_RW(pi) = (*pi & 0xffff0000) | (u16)(*pi + ((u8 *)pool - (u8 *)pi));
 	}
 	// count pool constants as insns for statistics
 	for (i = 0; i < literal_pindex * sizeof(uintptr_t)/sizeof(u32); i++)
@@ -1281,6 +1281,12 @@ static void emith_lohi_nops(void)
 #define emith_write_r_r_offs(r, rs, offs) \
 	EMIT(MIPS_SW(r, rs, offs))
 
+#define emith_write8_r_r_offs(r, rs, offs) \
+	EMIT(MIPS_SB(r, rs, offs))
+
+#define emith_write16_r_r_offs(r, rs, offs) \
+	EMIT(MIPS_SH(r, rs, offs))
+
 #define emith_write_r_r_r(r, rs, rm) do { \
 	emith_add_r_r_r_ptr(AT, rs, rm); \
 	EMIT(MIPS_SW(r, AT, 0)); \
@@ -483,7 +483,7 @@ enum { OPS_STD, OPS_STDU /*,OPS_STQ*/ };
 // XXX: tcache_ptr type for SVP and SH2 compilers differs..
 #define EMIT_PTR(ptr, x) \
 	do { \
-		*(u32 *)(ptr) = x; \
+		*(u32 *)TCACHE_RW(ptr) = x; \
 		ptr = (void *)((u8 *)(ptr) + sizeof(u32)); \
 	} while (0)
 
@@ -1194,6 +1194,12 @@ static void emith_add_imm(int rt, int ra, u32 imm)
 #define emith_write_r_r_offs(r, ra, offs) \
 	EMIT(PPC_STW_IMM(r, ra, offs))
 
+#define emith_write8_r_r_offs(r, ra, offs) \
+	EMIT(PPC_STB_IMM(r, ra, offs))
+
+#define emith_write16_r_r_offs(r, ra, offs) \
+	EMIT(PPC_STH_IMM(r, ra, offs))
+
 #define emith_write_r_r_r(r, ra, rm) \
 	EMIT(PPC_STW_REG(r, ra, rm))
 
@@ -57,7 +57,7 @@ enum { xAX = 0, xCX, xDX, xBX, xSP, xBP, xSI, xDI,	// x86-64,i386 common
 #define DCOND_CC ICOND_JAE     // carry clear
 
 #define EMIT_PTR(ptr, val, type) \
-	*(type *)(ptr) = val
+	*(type *)TCACHE_RW(ptr) = val
 
 #define EMIT(val, type) do { \
 	EMIT_PTR(tcache_ptr, val, type); \
@@ -723,7 +723,7 @@ enum { xAX = 0, xCX, xDX, xBX, xSP, xBP, xSI, xDI,	// x86-64,i386 common
 } while (0)
 
 #define emith_write8_r_r_offs(r, rs, offs) do {\
-	EMIT_REX_IF(0, r, rs); \
+	EMIT_REX8_IF(r, rs); \
 	emith_deref_op(0x88, r, rs, offs); \
 } while (0)
 
@@ -993,6 +993,12 @@ enum { xAX = 0, xCX, xDX, xBX, xSP, xBP, xSI, xDI,	// x86-64,i386 common
 #define EMIT_REX_IF(w, r, rm) \
 	EMIT_XREX_IF(w, r, rm, 0)
 
+// byte regs spl, bpl, sil, dil are only accessible with REX
+#define EMIT_REX8_IF(r, rm) do { \
+	if ((r) >= 4 || (rm) > 7) \
+		EMIT_REX(0, (r) > 7, 0, (rm) > 7); \
+} while (0)
+
 #ifndef _WIN32
 
 // SystemV ABI conventions:
@@ -1091,6 +1097,10 @@ enum { xAX = 0, xCX, xDX, xBX, xSP, xBP, xSI, xDI,	// x86-64,i386 common
 	assert((u32)(rs) < 8u); \
 	assert((u32)(rm) < 8u); \
 } while (0)
+#define EMIT_REX8_IF(r, rm) do { \
+	assert((u32)(r) < 4u); \
+	assert((u32)(rm) < 8u); \
+} while (0)
 
 // MS/SystemV ABI: ebx,esi,edi,ebp are preserved, eax,ecx,edx are temporaries
 // DRC uses REGPARM to pass upto 3 parameters in registers eax,ecx,edx.
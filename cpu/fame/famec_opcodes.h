@@ -40242,14 +40242,11 @@ RET(14)
 }
 
 #ifdef PICODRIVE_HACK
-#if 0
 #define UPDATE_IDLE_COUNT { \
-	extern int idle_hit_counter; \
-	idle_hit_counter++; \
+	extern void SekIdleSkipped(void *ctx, int cycles); \
+	if (ctx->io_cycle_counter > 0) \
+		SekIdleSkipped(ctx, ctx->io_cycle_counter); \
 }
-#else
-#define UPDATE_IDLE_COUNT
-#endif
 
 // BRA
 OPCODE(0x6001_idle)
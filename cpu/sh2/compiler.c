@@ -22,6 +22,8 @@
  * - call stack caching for host block entry address
  * - delay, poll, and idle loop detection and handling
  * - some T/M flag optimizations where the value is known or isn't used
+ * - inline SDRAM and data array accesses
+ * - superblocks following hot unconditional branches out of a block
  *
  * TODO:
  * - better constant propagation
@@ -48,12 +50,16 @@
 #define REMAP_REGISTER          1
 #define LOOP_DETECTION          1
 #define LOOP_OPTIMIZER          1
+#define SUPERBLOCKS             1
 #define T_OPTIMIZER             1
 #define DIV_OPTIMIZER           1
+#define INLINE_MEMACC           1
 
 #define MAX_LITERAL_OFFSET      0x200	// max. MOVA, MOV @(PC) offset
 #define MAX_LOCAL_TARGETS       (BLOCK_INSN_LIMIT / 4)
 #define MAX_LOCAL_BRANCHES      (BLOCK_INSN_LIMIT / 2)
+#define MAX_BLOCK_SEGS          4     // max. code ranges in a superblock
+#define TRACE_HOT_COUNT         16    // exits to a target to make it a trace
 
 // debug stuff
 // 01 - warnings/errors
@@ -68,6 +74,7 @@
 // 200 - compare trace
 // 400 - block entry backtrace on exit
 // 800 - state dump on exit
+// 1000 - inline memory access statistics
 #ifndef DRC_DEBUG
 #define DRC_DEBUG 0//x847
 #endif
@@ -149,6 +156,7 @@ enum op_types {
   OP_TRAPA,     // TRAPA instruction
   OP_LDC,       // LDC instruction
   OP_DIV0,      // DIV0[US] instruction
+  OP_BRANCH_T,  // BRA continuing in the next superblock segment
   OP_UNDEFINED,
 };
 
@@ -172,6 +180,45 @@ union _div { u32 imm; struct div div; };  // XXX tut-tut type punning...
 #define OP_ISBRAIND(op) (BITMASK3(OP_BRANCH_R, OP_BRANCH_RF, OP_RTE) \
                                 & BITMASK1(op))
 
+// a superblock continues at the target of a hot BRA leaving the block. The
+// insns of all its segments are consecutive in ops[], the last entry of
+// block_segs marks the end of the last segment.
+static struct block_seg {
+  u32 pc;       // SH2 PC of the 1st insn in the segment
+  int idx;      // index of that insn in ops[]
+} block_segs[MAX_BLOCK_SEGS+1];
+static int block_seg_count;
+
+// exit counters of BRAs leaving a block. A BRA is traced if its entry has
+// .pc == BRA pc|1, which is set once the counter has run down.
+static struct trace_exit {
+  u32 pc;
+  int count;
+} trace_exits[512];
+#define TRACE_EXIT(pc) \
+  trace_exits[((pc) >> 1) & (ARRAY_SIZE(trace_exits)-1)]
+
+// SH2 PC of the insn in ops[i]
+static inline u32 op_pc(int i)
+{
+  int s = block_seg_count;
+
+  while (--s > 0 && i < block_segs[s].idx)
+    ;
+  return block_segs[s].pc + 2*(i - block_segs[s].idx);
+}
+
+// index in ops[] of the insn at pc, -1 if it isn't in the block
+static inline int op_idx(u32 pc)
+{
+  int s;
+
+  for (s = 0; s < block_seg_count; s++)
+    if (pc - block_segs[s].pc < 2*(block_segs[s+1].idx - block_segs[s].idx))
+      return block_segs[s].idx + (pc - block_segs[s].pc) / 2;
+  return -1;
+}
+
 #ifdef DRC_SH2
 
 #if (DRC_DEBUG & 4)
@@ -344,6 +391,8 @@ struct block_desc {
   u32 addr_lit;              // block start SH2 literal pool addr
   int size;                  // ..of recompiled insns
   int size_lit;              // ..of (insns+)literal pool
+  u32 addr_seg[MAX_BLOCK_SEGS-1]; // further insn ranges in a superblock
+  int size_seg[MAX_BLOCK_SEGS-1]; // ..0 if not used
   u8 *tcache_ptr;            // start address of block in cache
   u16 crc;                   // crc of insns and literals
   u16 active;                // actively used or deactivated?
@@ -418,6 +467,9 @@ int bchit, bcmiss;
 int rchit, rcmiss;
 #endif
 #endif
+#if (DRC_DEBUG & 0x1000)
+int mrhit[2], mrmiss, mwhit[2], mwmiss; // [0] SDRAM, [1] data array
+#endif
 
 // host register tracking
 enum cache_reg_htype {
@@ -858,12 +910,12 @@ static void dr_block_unlink(struct block_link *bl, int emit_jump)
         emith_jump_patch(jump, sh2_drc_dispatcher, &jump);
       } else if (bl->type == BL_LDJMP) { // restore: load pc, jump @dispatcher
         // inlined: @jump load target_pc, far jump to dispatcher
-        memcpy(jump, bl->jdisp, emith_jump_at_size());
+        memcpy(TCACHE_RW(jump), bl->jdisp, emith_jump_at_size());
         jsz = emith_jump_at_size();
       } else if (bl->type == BL_JCCBLX) { // jump cond @blx; @blx: load pc, jump
         // via blx: @jump near jumpcc to blx; @blx load target_pc, far jump
         emith_jump_patch(bl->jump, bl->blx, &jump);
-        memcpy(bl->blx, bl->jdisp, emith_jump_at_size());
+        memcpy(TCACHE_RW(bl->blx), bl->jdisp, emith_jump_at_size());
         host_instructions_updated(bl->blx, (char *)bl->blx + emith_jump_at_size(), 1);
       } else {
         printf("unknown BL type %d\n", bl->type);
@@ -927,6 +979,7 @@ static void dr_mark_memory(int mark, struct block_desc *block, int tcache_id, u3
 {
   u8 *drc_ram_blk = NULL, *lit_ram_blk = NULL;
   u32 addr, end, mask = 0, shift = 0, idx;
+  int s;
 
   // mark memory blocks as containing compiled code
   if ((block->addr & 0xc7fc0000) == 0x06000000
@@ -959,6 +1012,14 @@ static void dr_mark_memory(int mark, struct block_desc *block, int tcache_id, u3
     for (idx = (addr & mask) >> shift; addr < end; addr += (1 << shift))
       drc_ram_blk[idx++] += mark;
 
+    // mark further superblock segments
+    for (s = 0; s < ARRAY_SIZE(block->size_seg) && block->size_seg[s]; s++) {
+      addr = block->addr_seg[s] & ~((1 << shift) - 1);
+      end = block->addr_seg[s] + block->size_seg[s];
+      for (idx = (addr & mask) >> shift; addr < end; addr += (1 << shift))
+        drc_ram_blk[idx++] += mark;
+    }
+
     // mark for literals disabled
     if (nolit) {
       addr = nolit & ~((1 << shift) - 1);
@@ -981,6 +1042,16 @@ static void dr_mark_memory(int mark, struct block_desc *block, int tcache_id, u3
       end = block->addr_lit + block->size_lit;
       for (idx = (addr & mask) / INVAL_PAGE_SIZE; addr < end; addr += INVAL_PAGE_SIZE)
         add_to_block_list(&inval_lookup[tcache_id][idx++], block);
+
+      // segments may share pages with other ranges, add only once per page
+      for (s = 0; s < ARRAY_SIZE(block->size_seg) && block->size_seg[s]; s++) {
+        addr = block->addr_seg[s] & ~(INVAL_PAGE_SIZE - 1);
+        end = block->addr_seg[s] + block->size_seg[s];
+        for (idx = (addr & mask) / INVAL_PAGE_SIZE; addr < end; addr += INVAL_PAGE_SIZE, idx++)
+          if (!inval_lookup[tcache_id][idx] ||
+              inval_lookup[tcache_id][idx]->block != block)
+            add_to_block_list(&inval_lookup[tcache_id][idx], block);
+      }
     }
   }
 }
@@ -1071,7 +1142,7 @@ static void dr_rm_block_entry(struct block_desc *bd, int tcache_id, u32 nolit, i
 }
 
 static struct block_desc *dr_find_inactive_block(int tcache_id, u16 crc,
-  u32 addr, int size, u32 addr_lit, int size_lit)
+  u32 addr, int size, u32 addr_lit, int size_lit, u32 *addr_seg, int *size_seg)
 {
   struct block_list **head = &inactive_blocks[tcache_id];
   struct block_list *current;
@@ -1079,7 +1150,9 @@ static struct block_desc *dr_find_inactive_block(int tcache_id, u16 crc,
   for (current = *head; current != NULL; current = current->next) {
     struct block_desc *block = current->block;
     if (block->crc == crc && block->addr == addr && block->size == size &&
-        block->addr_lit == addr_lit && block->size_lit == size_lit)
+        block->addr_lit == addr_lit && block->size_lit == size_lit &&
+        !memcmp(block->addr_seg, addr_seg, sizeof(block->addr_seg)) &&
+        !memcmp(block->size_seg, size_seg, sizeof(block->size_seg)))
     {
       rm_from_block_lists(block);
       return block;
@@ -1089,7 +1162,8 @@ static struct block_desc *dr_find_inactive_block(int tcache_id, u16 crc,
 }
 
 static struct block_desc *dr_add_block(int entries, u32 addr, int size,
-  u32 addr_lit, int size_lit, u16 crc, int is_slave, int *blk_id)
+  u32 addr_lit, int size_lit, u32 *addr_seg, int *size_seg, u16 crc,
+  int is_slave, int *blk_id)
 {
   struct block_entry *be;
   struct block_desc *bd;
@@ -1114,6 +1188,8 @@ static struct block_desc *dr_add_block(int entries, u32 addr, int size,
   bd->size = size;
   bd->addr_lit = addr_lit;
   bd->size_lit = size_lit;
+  memcpy(bd->addr_seg, addr_seg, sizeof(bd->addr_seg));
+  memcpy(bd->size_seg, size_seg, sizeof(bd->size_seg));
   bd->tcache_ptr = tcache_ptr;
   bd->crc = crc;
   bd->active = 0;
@@ -1237,6 +1313,43 @@ static inline void dr_reserve_cache(int tcache_id, struct ring_buffer *rb, int c
     dr_free_oldest_block(tcache_id);
 }
 
+// clear branch cache and return stack, they may point to removed blocks
+static void dr_flush_branch_cache(int tcache_id)
+{
+#if BRANCH_CACHE
+  if (tcache_id)
+    memset32(sh2s[tcache_id-1].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
+  else {
+    memset32(sh2s[0].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
+    memset32(sh2s[1].branch_cache, -1, sizeof(sh2s[1].branch_cache)/4);
+  }
+#endif
+#if CALL_STACK
+  if (tcache_id) {
+    memset32(sh2s[tcache_id-1].rts_cache, -1, sizeof(sh2s[0].rts_cache)/4);
+    sh2s[tcache_id-1].rts_cache_idx = 0;
+  } else {
+    memset32(sh2s[0].rts_cache, -1, sizeof(sh2s[0].rts_cache)/4);
+    memset32(sh2s[1].rts_cache, -1, sizeof(sh2s[1].rts_cache)/4);
+    sh2s[0].rts_cache_idx = sh2s[1].rts_cache_idx = 0;
+  }
+#endif
+}
+
+// called from a block exit which was often taken. Remove the block so that it
+// is retranslated as superblock continuing at the exit target.
+static void REGPARM(3) sh2_drc_trace_hot(struct block_desc *bd, u32 pc,
+  int tcache_id)
+{
+  TRACE_EXIT(pc).pc = pc | 1;
+  if (bd->addr == 0 || !bd->active)
+    return;
+
+  dbg(2, "trace %08x in block %08x", pc, bd->addr);
+  dr_rm_block_entry(bd, tcache_id, 0, 1);
+  dr_flush_branch_cache(tcache_id);
+}
+
 static u8 *dr_prepare_cache(int tcache_id, int insn_count, int entry_count)
 {
   int bf = block_ring[tcache_id].first;
@@ -1251,24 +1364,7 @@ static u8 *dr_prepare_cache(int tcache_id, int insn_count, int entry_count)
 
   if (bf != block_ring[tcache_id].first) {
     // deleted some block(s), clear branch cache and return stack
-#if BRANCH_CACHE
-    if (tcache_id)
-      memset32(sh2s[tcache_id-1].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
-    else {
-      memset32(sh2s[0].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
-      memset32(sh2s[1].branch_cache, -1, sizeof(sh2s[1].branch_cache)/4);
-    }
-#endif
-#if CALL_STACK
-    if (tcache_id) {
-      memset32(sh2s[tcache_id-1].rts_cache, -1, sizeof(sh2s[0].rts_cache)/4);
-      sh2s[tcache_id-1].rts_cache_idx = 0;
-    } else {
-      memset32(sh2s[0].rts_cache, -1, sizeof(sh2s[0].rts_cache)/4);
-      memset32(sh2s[1].rts_cache, -1, sizeof(sh2s[1].rts_cache)/4);
-      sh2s[0].rts_cache_idx = sh2s[1].rts_cache_idx = 0;
-    }
-#endif
+    dr_flush_branch_cache(tcache_id);
   }
 
   return ring_next(&tcache_ring[tcache_id]);
@@ -1309,6 +1405,7 @@ static void dr_flush_tcache(int tcid)
     memset(sh2s[tcid - 1].rts_cache, -1, sizeof(sh2s[0].rts_cache));
     sh2s[tcid - 1].rts_cache_idx = 0;
   }
+  sh2_pdc_flush(tcid);
 #if (DRC_DEBUG & 4)
   tcache_dsm_ptrs[tcid] = tcache_ring[tcid].base;
 #endif
@@ -2469,6 +2566,42 @@ static void rcache_clean(void)
   rcache_regs_clean = 0;
 }
 
+// snapshot of the cache for code in a conditionally executed path, e.g. a
+// side exit, which must not change the state seen by the main path
+struct rcache_state {
+  cache_reg_t cache_regs[ARRAY_SIZE(cache_regs)];
+  guest_reg_t guest_regs[ARRAY_SIZE(guest_regs)];
+  gconst_t gconsts[ARRAY_SIZE(gconsts)];
+  u16 counter;
+  u32 regs_now, regs_soon, regs_late, regs_discard, regs_clean;
+};
+
+static void rcache_save_state(struct rcache_state *rs)
+{
+  memcpy(rs->cache_regs, cache_regs, sizeof(cache_regs));
+  memcpy(rs->guest_regs, guest_regs, sizeof(guest_regs));
+  memcpy(rs->gconsts, gconsts, sizeof(gconsts));
+  rs->counter = rcache_counter;
+  rs->regs_now = rcache_regs_now;
+  rs->regs_soon = rcache_regs_soon;
+  rs->regs_late = rcache_regs_late;
+  rs->regs_discard = rcache_regs_discard;
+  rs->regs_clean = rcache_regs_clean;
+}
+
+static void rcache_restore_state(struct rcache_state *rs)
+{
+  memcpy(cache_regs, rs->cache_regs, sizeof(cache_regs));
+  memcpy(guest_regs, rs->guest_regs, sizeof(guest_regs));
+  memcpy(gconsts, rs->gconsts, sizeof(gconsts));
+  rcache_counter = rs->counter;
+  rcache_regs_now = rs->regs_now;
+  rcache_regs_soon = rs->regs_soon;
+  rcache_regs_late = rs->regs_late;
+  rcache_regs_discard = rs->regs_discard;
+  rcache_regs_clean = rs->regs_clean;
+}
+
 static void rcache_invalidate_tmp(void)
 {
   int i;
@@ -2493,9 +2626,10 @@ static void rcache_invalidate(void)
   for (i = 0; i < ARRAY_SIZE(cache_regs); i++)
     rcache_free_vreg(i);
 
+  // pinned regs stay in their host regs like statics until unpinned
   for (i = 0; i < ARRAY_SIZE(guest_regs); i++) {
-    guest_regs[i].flags &= GRF_STATIC;
-    if (!(guest_regs[i].flags & GRF_STATIC))
+    guest_regs[i].flags &= GRF_STATIC|GRF_PINNED;
+    if (!(guest_regs[i].flags & (GRF_STATIC|GRF_PINNED)))
       guest_regs[i].vreg = -1;
     else {
       cache_regs[guest_regs[i].sreg].gregs = 1 << i;
@@ -2597,6 +2731,15 @@ static void emit_le_ptr8(int r)
 #endif
 }
 
+// same as macros, for code which is conditionally executed on ARM
+#if CPU_IS_LE
+#define EMIT_LE_SWAP(d, s)  emith_ror(d, s, 16)
+#define EMIT_LE_PTR8(r)     emith_eor_r_imm_ptr(r, 1)
+#else
+#define EMIT_LE_SWAP(d, s)  do { if ((d) != (s)) emith_move_r_r(d, s); } while (0)
+#define EMIT_LE_PTR8(r)     do { } while (0)
+#endif
+
 // split address by mask, in base part (upper) and offset (lower, signed!)
 static uptr split_address(uptr la, uptr mask, s32 *offs)
 {
@@ -2766,10 +2909,87 @@ static void emit_sync_t_to_sr(void)
   }
 }
 
+#if INLINE_MEMACC
+// Inline access to SDRAM and the data array, which get most of the traffic.
+// The fast path is taken if the address is in the region, and for writes if
+// there is neither translated code nor a poll address at that location.
+// These are macros since ARM emits the fast path as conditional insns.
+
+// t = 0 if a is in SDRAM, cached or cache-through
+#define EMIT_SDRAM_CHECK(t, a) do { \
+  emith_lsr(t, a, SH2_READ_SHIFT); \
+  emith_bic_r_imm(t, 0x20 >> 1); \
+  emith_eor_r_imm(t, 0x06 >> 1); \
+} while (0)
+
+// t = 0 if a is in the data array
+#define EMIT_DA_CHECK(t, a) do { \
+  emith_lsr(t, a, SH2_READ_SHIFT); \
+  emith_eor_r_imm(t, 0xc0 >> 1); \
+} while (0)
+
+// t2 = drc block map entries for a
+#define EMIT_DRCBLK_READ(size, a, blk, mask, shift, t1, t2) do { \
+  emith_ctx_read_ptr(t1, offsetof(SH2, blk)); \
+  emith_and_r_r_imm(t2, a, (mask) & ~((1 << (size)) - 1)); \
+  emith_lsr(t2, t2, shift); \
+  if ((size) == 2) /* both words */ \
+    emith_read16_r_r_r(t2, t1, t2); \
+  else \
+    emith_read8_r_r_r(t2, t1, t2); \
+} while (0)
+
+// rd = @(mem + (a & mask)), sign extended like in the read handlers
+#define EMIT_READ_DIRECT(size, rd, a, mem, mask, t1, t2) do { \
+  emith_ctx_read_ptr(t1, offsetof(SH2, mem)); \
+  emith_and_r_r_imm(t2, a, (mask) & ~((1 << (size)) - 1)); \
+  if ((size) == 0) { \
+    EMIT_LE_PTR8(t2); \
+    emith_read8s_r_r_r(rd, t1, t2); \
+  } else if ((size) == 1) \
+    emith_read16s_r_r_r(rd, t1, t2); \
+  else { \
+    emith_read_r_r_r(rd, t1, t2); \
+    EMIT_LE_SWAP(rd, rd); \
+  } \
+} while (0)
+
+// @(mem + (a & mask)) = d
+#define EMIT_WRITE_DIRECT(size, d, a, mem, mask, t1, t2) do { \
+  emith_ctx_read_ptr(t1, offsetof(SH2, mem)); \
+  emith_and_r_r_imm(t2, a, (mask) & ~((1 << (size)) - 1)); \
+  if ((size) == 0) \
+    EMIT_LE_PTR8(t2); \
+  emith_add_r_r_ptr(t1, t2); \
+  if ((size) == 0) \
+    emith_write8_r_r_offs(d, t1, 0); \
+  else if ((size) == 1) \
+    emith_write16_r_r_offs(d, t1, 0); \
+  else { \
+    EMIT_LE_SWAP(t2, d); \
+    emith_write_r_r_offs(t2, t1, 0); \
+  } \
+} while (0)
+#endif
+
+#if (DRC_DEBUG & 0x1000)
+#define EMIT_MEMACC_COUNT(cnt, t1, t2) do { \
+  emith_move_r_ptr_imm(t1, (uptr)&(cnt)); \
+  emith_read_r_r_offs(t2, t1, 0); \
+  emith_add_r_imm(t2, 1); \
+  emith_write_r_r_offs(t2, t1, 0); \
+} while (0)
+#else
+#define EMIT_MEMACC_COUNT(cnt, t1, t2) do { } while (0)
+#endif
+
 // rd = @(arg0)
 static int emit_memhandler_read(int size)
 {
   int hr;
+#if INLINE_MEMACC
+  int a, t1, t2;
+#endif
 
   emit_sync_t_to_sr();
   rcache_clean_tmp();
@@ -2786,12 +3006,35 @@ static int emit_memhandler_read(int size)
     case 1:   emith_call(sh2_drc_read16_poll);  break; // 16
     case 2:   emith_call(sh2_drc_read32_poll);  break; // 32
     }
-  else
+  else {
+#if INLINE_MEMACC
+    host_arg2reg(a, 0);
+    host_arg2reg(t1, 2);
+    host_arg2reg(t2, 3);
+    EMIT_SDRAM_CHECK(t1, a);
+    emith_tst_r_r(t1, t1);
+    EMITH_SJMP2_START(DCOND_NE);
+    EMIT_READ_DIRECT(size & MF_SIZEMASK, RET_REG, a, p_sdram, 0x3ffff, t1, t2);
+    EMIT_MEMACC_COUNT(mrhit[0], t1, t2);
+    EMITH_SJMP2_MID(DCOND_NE);
+    EMIT_DA_CHECK(t1, a);
+    emith_tst_r_r(t1, t1);
+    EMITH_SJMP2_START(DCOND_NE);
+    EMIT_READ_DIRECT(size & MF_SIZEMASK, RET_REG, a, p_da, 0xfff, t1, t2);
+    EMIT_MEMACC_COUNT(mrhit[1], t1, t2);
+    EMITH_SJMP2_MID(DCOND_NE);
+    EMIT_MEMACC_COUNT(mrmiss, t1, t2);
+#endif
     switch (size & MF_SIZEMASK) {
     case 0:   emith_call(sh2_drc_read8);        break; // 8
     case 1:   emith_call(sh2_drc_read16);       break; // 16
     case 2:   emith_call(sh2_drc_read32);       break; // 32
     }
+#if INLINE_MEMACC
+    EMITH_SJMP2_END(DCOND_NE);
+    EMITH_SJMP2_END(DCOND_NE);
+#endif
+  }
 
   hr = rcache_get_tmp_ret();
   rcache_set_x16(hr, (size & MF_SIZEMASK) < 2, 0);
@@ -2801,6 +3044,10 @@ static int emit_memhandler_read(int size)
 // @(arg0) = arg1
 static void emit_memhandler_write(int size)
 {
+#if INLINE_MEMACC
+  int a, d, t1, t2;
+#endif
+
   emit_sync_t_to_sr();
   rcache_clean_tmp();
 #ifndef DRC_SR_REG
@@ -2809,11 +3056,40 @@ static void emit_memhandler_write(int size)
 #endif
   rcache_invalidate_tmp();
 
+#if INLINE_MEMACC
+  host_arg2reg(a, 0);
+  host_arg2reg(d, 1);
+  host_arg2reg(t1, 2);
+  host_arg2reg(t2, 3);
+  EMIT_DRCBLK_READ(size & MF_SIZEMASK, a, p_drcblk_ram, 0x3ffff,
+                   SH2_DRCBLK_RAM_SHIFT, t1, t2);
+  EMIT_SDRAM_CHECK(t1, a);
+  emith_or_r_r(t1, t2);
+  emith_tst_r_r(t1, t1);
+  EMITH_SJMP2_START(DCOND_NE);
+  EMIT_WRITE_DIRECT(size & MF_SIZEMASK, d, a, p_sdram, 0x3ffff, t1, t2);
+  EMIT_MEMACC_COUNT(mwhit[0], t1, t2);
+  EMITH_SJMP2_MID(DCOND_NE);
+  EMIT_DRCBLK_READ(size & MF_SIZEMASK, a, p_drcblk_da, 0xfff,
+                   SH2_DRCBLK_DA_SHIFT, t1, t2);
+  EMIT_DA_CHECK(t1, a);
+  emith_or_r_r(t1, t2);
+  emith_tst_r_r(t1, t1);
+  EMITH_SJMP2_START(DCOND_NE);
+  EMIT_WRITE_DIRECT(size & MF_SIZEMASK, d, a, p_da, 0xfff, t1, t2);
+  EMIT_MEMACC_COUNT(mwhit[1], t1, t2);
+  EMITH_SJMP2_MID(DCOND_NE);
+  EMIT_MEMACC_COUNT(mwmiss, t1, t2);
+#endif
   switch (size & MF_SIZEMASK) {
   case 0:   emith_call(sh2_drc_write8);     break;  // 8
   case 1:   emith_call(sh2_drc_write16);    break;  // 16
   case 2:   emith_call(sh2_drc_write32);    break;  // 32
   }
+#if INLINE_MEMACC
+  EMITH_SJMP2_END(DCOND_NE);
+  EMITH_SJMP2_END(DCOND_NE);
+#endif
 }
 
 // rd = @(Rs,#offs); rd < 0 -> return a temp
@@ -3160,6 +3436,13 @@ struct linkage {
   u32 mask;
 };
 
+// loop with pinned regs, from its head up to the last backward jump to it
+struct pinned_loop {
+  int idx, end; // ops[] index of head and after the end
+  void *ptr;
+  u32 mask;
+};
+
 static inline int find_in_linkage(const struct linkage *array, int size, u32 pc)
 {
   size_t i;
@@ -3276,13 +3559,18 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 #if LOOP_OPTIMIZER
   // loops with pinned registers for optimzation
   // pinned regs are like statics and don't need saving/restoring inside a loop
-  static struct linkage pinned_loops[MAX_LOCAL_TARGETS/16];
+  static struct pinned_loop pinned_loops[MAX_LOCAL_TARGETS/16];
   int pinned_loop_count = 0;
 #endif
 
   // PC of current, first, last SH2 insn
   u32 pc, base_pc, end_pc;
   u32 base_literals, end_literals;
+  // superblock segments after the 1st one
+  u32 seg_addr[MAX_BLOCK_SEGS-1];
+  int seg_size[MAX_BLOCK_SEGS-1];
+  int insn_count, seg;
+  int trace = SUPERBLOCKS && !(PicoIn.opt & POPT_DIS_SH2_TRACE);
   u8 *block_entry_ptr;
   struct block_desc *block;
   struct block_entry *entry;
@@ -3309,14 +3597,22 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
   }
 
   // initial passes to disassemble and analyze the block
-  crc = scan_block(base_pc, sh2->is_slave, op_flags, &end_pc, &base_literals, &end_literals);
+  crc = scan_block(base_pc, sh2->is_slave, op_flags, &end_pc, &base_literals,
+    &end_literals, trace);
   end_literals = dr_check_nolit(base_literals, end_literals, tcache_id);
   if (base_literals == end_literals) // map empty lit section to end of code
     base_literals = end_literals = end_pc;
+  insn_count = block_segs[block_seg_count].idx;
+  memset(seg_addr, 0, sizeof(seg_addr));
+  memset(seg_size, 0, sizeof(seg_size));
+  for (seg = 1; seg < block_seg_count; seg++) {
+    seg_addr[seg-1] = block_segs[seg].pc;
+    seg_size[seg-1] = 2*(block_segs[seg+1].idx - block_segs[seg].idx);
+  }
 
   // if there is already a translated but inactive block, reuse it
   block = dr_find_inactive_block(tcache_id, crc, base_pc, end_pc - base_pc,
-    base_literals, end_literals - base_literals);
+    base_literals, end_literals - base_literals, seg_addr, seg_size);
 
 #if (DRC_DEBUG & (256|512))
   // remove any (partial) old blocks which might get in the way, to make sure
@@ -3335,7 +3631,8 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 
   // collect branch_targets that don't land on delay slots
   m1 = m2 = m3 = m4 = v = op = 0;
-  for (pc = base_pc, i = 0; pc < end_pc; i++, pc += 2) {
+  for (i = 0; i < insn_count; i++) {
+    pc = op_pc(i);
     if (op_flags[i] & OF_DELAY_OP)
       op_flags[i] &= ~OF_BTARGET;
     if (op_flags[i] & OF_BTARGET) {
@@ -3343,11 +3640,11 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
         branch_targets[branch_target_count++] = (struct linkage) { .pc = pc };
       else {
         printf("warning: linkage overflow\n");
-        end_pc = pc;
+        insn_count = i;
         break;
       }
     }
-    if (ops[i].op == OP_LDC && (ops[i].dest & BITMASK1(SHR_SR)) && pc+2 < end_pc)
+    if (ops[i].op == OP_LDC && (ops[i].dest & BITMASK1(SHR_SR)) && i+1 < insn_count)
       op_flags[i+1] |= OF_BTARGET; // RTE entrypoint in case of SR.IMASK change
     // unify T and SR since rcache doesn't know about "virtual" guest regs
     if (ops[i].source & BITMASK1(SHR_T))  ops[i].source |= BITMASK1(SHR_SR);
@@ -3397,7 +3694,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
       }
       // branch detector
       if (OP_ISBRAIMM(ops[i].op)) {
-        if (ops[i].imm == base_pc + 2*v)
+        if (ops[i].imm == op_pc(v))
           drcf.pending_branch_direct = 1;       // backward branch detected
         else
           op_flags[v] &= ~OF_BASIC_LOOP;        // no basic loop
@@ -3416,8 +3713,8 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
           m3 &= ~rcache_regs_static & ~BITMASK5(SHR_PC, SHR_PR, SHR_SR, SHR_T, SHR_MEM);
           if (m3 && count_bits(m3) < count_bits(rcache_vregs_reg) &&
               pinned_loop_count < ARRAY_SIZE(pinned_loops)-1) {
-            pinned_loops[pinned_loop_count++] =
-                (struct linkage) { .pc = base_pc + 2*v, .mask = m3 };
+            pinned_loops[pinned_loop_count++] = (struct pinned_loop)
+                { .idx = v, .end = i + 1, .mask = m3 };
           } else
             op_flags[v] &= ~OF_BASIC_LOOP;
         }
@@ -3426,14 +3723,103 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
     }
 #endif
   }
+  // drop superblock segments cut off by a linkage overflow
+  while (block_seg_count > 1 && block_segs[block_seg_count-1].idx >= insn_count) {
+    block_seg_count--;
+    seg_addr[block_seg_count-1] = seg_size[block_seg_count-1] = 0;
+    ops[block_segs[block_seg_count].idx - 2].op = OP_BRANCH;
+  }
+  if (block_seg_count > 1)
+    seg_size[block_seg_count-2] = 2*(insn_count - block_segs[block_seg_count-1].idx);
+  else
+    end_pc = base_pc + 2*insn_count;
+  block_segs[block_seg_count].idx = insn_count;
+  // branch_targets must be sorted by pc, segments may be in any order
+  for (i = 1; block_seg_count > 1 && i < branch_target_count; i++) {
+    struct linkage lt = branch_targets[i];
+    for (v = i; v > 0 && branch_targets[v-1].pc > lt.pc; v--)
+      branch_targets[v] = branch_targets[v-1];
+    branch_targets[v] = lt;
+  }
 
-  tcache_ptr = dr_prepare_cache(tcache_id, (end_pc - base_pc) / 2, branch_target_count);
+#if LOOP_OPTIMIZER
+  // loops with inner branch targets and exits, which would otherwise flush
+  // all regs at each target. Pin the most used regs from the loop head up to
+  // the last backward jump to it. The inner targets are no block entries and
+  // keep the pinned regs, they are saved to ctx when leaving the loop.
+  for (i = 0; i < insn_count; i++) {
+    u8 reg_use[32];
+    int e, k;
+
+    if (!OP_ISBRAIMM(ops[i].op) || (ops[i].dest & BITMASK1(SHR_PR)))
+      continue;
+    v = op_idx(ops[i].imm);
+    if (v < 0 || v >= i || (op_flags[v] & (OF_LOOP|OF_BASIC_LOOP)))
+      continue;
+    // the loop ends with the last backward jump to its head
+    for (k = e = i; k < insn_count; k++)
+      if (OP_ISBRAIMM(ops[k].op) && ops[k].imm == ops[i].imm)
+        e = k;
+    e += (op_flags[e+1] & OF_DELAY_OP) ? 2 : 1;
+
+    // no overlapping with other pinned loops
+    for (k = 0; k < pinned_loop_count; k++)
+      if (pinned_loops[k].idx < e && v < pinned_loops[k].end)
+        break;
+    if (k < pinned_loop_count || pinned_loop_count >= ARRAY_SIZE(pinned_loops)-1)
+      continue;
+
+    // nothing inside which can flush the rcache or leave the loop indirectly,
+    // and no entry from outside except at the loop head
+    memset(reg_use, 0, sizeof(reg_use));
+    for (k = 0; k < insn_count; k++) {
+      if (k >= v && k < e) {
+        if (OP_ISBRAIND(ops[k].op) || ops[k].op == OP_SLEEP ||
+            ops[k].op == OP_TRAPA || ops[k].op == OP_UNDEFINED ||
+            (ops[k].op == OP_LDC && (ops[k].dest & BITMASK1(SHR_SR))) ||
+            (OP_ISBRAIMM(ops[k].op) && (ops[k].dest & BITMASK1(SHR_PR))) ||
+            (k > v && (op_flags[k] & (OF_LOOP|OF_BASIC_LOOP))))
+          break;
+        m3 = (ops[k].source | ops[k].dest) & ~rcache_regs_static &
+                ~BITMASK5(SHR_PC, SHR_PR, SHR_SR, SHR_T, SHR_MEM);
+        FOR_ALL_BITS_SET_DO(m3, tmp, if (reg_use[tmp] < 255) reg_use[tmp]++);
+      } else if (OP_ISBRAIMM(ops[k].op) && (tmp = op_idx(ops[k].imm)) > v &&
+                 tmp < e)
+        break;
+    }
+    if (k < insn_count)
+      continue;
+
+    // pin the most used regs, leaving at least one host reg for caching
+    m3 = 0;
+    for (tmp2 = count_bits(rcache_vregs_reg)-1; tmp2 > 0; tmp2--) {
+      for (k = tmp = 0; k < ARRAY_SIZE(reg_use); k++)
+        if (reg_use[k] > reg_use[tmp])
+          tmp = k;
+      if (reg_use[tmp] < 2)
+        break;
+      m3 |= BITMASK1(tmp);
+      reg_use[tmp] = 0;
+    }
+    if (!m3)
+      continue;
+
+    // keep pinned_loops sorted by position in the block
+    for (k = pinned_loop_count++; k > 0 && pinned_loops[k-1].idx > v; k--)
+      pinned_loops[k] = pinned_loops[k-1];
+    pinned_loops[k] = (struct pinned_loop) { .idx = v, .end = e, .mask = m3 };
+    op_flags[v] |= OF_BASIC_LOOP;
+  }
+#endif
+
+  tcache_ptr = dr_prepare_cache(tcache_id, insn_count, branch_target_count);
 #if (DRC_DEBUG & 4)
   tcache_dsm_ptrs[tcache_id] = tcache_ptr;
 #endif
 
   block = dr_add_block(branch_target_count, base_pc, end_pc - base_pc,
-    base_literals, end_literals-base_literals, crc, sh2->is_slave, &blkid_main);
+    base_literals, end_literals-base_literals, seg_addr, seg_size, crc,
+    sh2->is_slave, &blkid_main);
   if (block == NULL)
     return NULL;
 
@@ -3443,11 +3829,12 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 
 
   // clear stale state after compile errors
+  rcache_unpin_all();
   rcache_invalidate();
   emith_invalidate_t();
   drcf = (struct drcf) { 0 };
 #if LOOP_OPTIMIZER
-  pinned_loops[pinned_loop_count].pc = -1;
+  pinned_loops[pinned_loop_count].idx = -1;
   pinned_loop_count = 0;
 #endif
 
@@ -3455,15 +3842,22 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
   // 3rd pass: actual compilation
   pc = base_pc;
   cycles = 0;
-  for (i = 0; pc < end_pc; i++)
+  for (i = 0, seg = 0; i < insn_count; i++)
   {
     u32 delay_dep_fw = 0, delay_dep_bk = 0;
     int tmp3, tmp4;
     int sr;
 
+    if (seg+1 < block_seg_count && i == block_segs[seg+1].idx) {
+      // continue in the next superblock segment
+      pc = block_segs[++seg].pc;
+      dbg(2, "-- %csh2 block #%d,%d segment %08x",
+        sh2->is_slave ? 's' : 'm', tcache_id, blkid_main, pc);
+    }
+
     if (op_flags[i] & OF_BTARGET)
     {
-      if (pc != base_pc)
+      if (i != 0)
       {
         sr = rcache_get_reg(SHR_SR, RC_GR_RMW, NULL);
         FLUSH_CYCLES(sr);
@@ -3476,6 +3870,13 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
       // make block entry
       v = block->entry_count;
       entry = &block->entryp[v];
+#if LOOP_OPTIMIZER
+      if (drcf.pinning) {
+        // inner target of a pinned loop, the pinned regs aren't in ctx here
+        dbg(2, "-- %csh2 block #%d,%d pinned loop target %08x",
+          sh2->is_slave ? 's' : 'm', tcache_id, blkid_main, pc);
+      } else
+#endif
       if (v < branch_target_count)
       {
         entry = &block->entryp[v];
@@ -3530,7 +3931,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
 
 #if LOOP_OPTIMIZER
       if (op_flags[i] & OF_BASIC_LOOP) {
-        if (pinned_loops[pinned_loop_count].pc == pc) {
+        if (pinned_loops[pinned_loop_count].idx == i) {
           // pin needed regs on loop entry 
           FOR_ALL_BITS_SET_DO(pinned_loops[pinned_loop_count].mask, v, rcache_pin_reg(v));
           emith_flush();
@@ -3541,7 +3942,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
           op_flags[i] &= ~OF_BASIC_LOOP;
       }
 
-      if (op_flags[i] & OF_BASIC_LOOP) {
+      if ((op_flags[i] & OF_BASIC_LOOP) || drcf.pinning) {
         // if exiting a pinned loop pinned regs must be written back to ctx
         // since they are reloaded in the loop entry code
         emith_cmp_r_imm(sr, 0);
@@ -3696,6 +4097,7 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
         else {
           switch (ops[i-1].op) {
           case OP_BRANCH:
+          case OP_BRANCH_T:
             emit_move_r_imm32(SHR_PC, ops[i-1].imm);
             break;
           case OP_BRANCH_CT:
@@ -3729,10 +4131,12 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
     u32 soon = 0;             // regs read soon
     for (v = 1; v <= 9; v++) {
       // no sense in looking any further than the next rcache flush
-      tmp = ((op_flags[i+v] & OF_BTARGET) || (op_flags[i+v-1] & OF_DELAY_OP) ||
+      // (a trace BRA continues without flush in the next segment)
+      tmp = ((op_flags[i+v] & OF_BTARGET) ||
+                ((op_flags[i+v-1] & OF_DELAY_OP) && opd[v-2].op != OP_BRANCH_T) ||
                 (OP_ISBRACND(opd[v-1].op) && !(op_flags[i+v] & OF_DELAY_OP)));
       // XXX looking behind cond branch to avoid evicting regs used later?
-      if (pc + 2*v <= end_pc && !tmp) { // (pc already incremented above)
+      if (i + v < insn_count && !tmp) {
         late |= opd[v].source & ~write;
         // ignore source regs after they have been written to
         write |= opd[v].dest;
@@ -3754,6 +4158,8 @@ static void REGPARM(2) *sh2_translate(SH2 *sh2, int tcache_id)
     {
     case OP_BRANCH_N:
       // never taken, just use up cycles
+    case OP_BRANCH_T:
+      // continued in the next segment, just use up cycles
       goto end_op;
     case OP_BRANCH:
     case OP_BRANCH_CT:
@@ -4941,7 +5347,7 @@ end_op:
       FLUSH_CYCLES(sr);
       emith_sync_t(sr);
       if (!drcf.pending_branch_indirect)
-        emit_move_r_imm32(SHR_PC, pc);
+        emit_move_r_imm32(SHR_PC, op_pc(i+1));
       rcache_flush();
       emith_call(sh2_drc_test_irq);
       drcf.test_irq = 0;
@@ -4954,6 +5360,7 @@ end_op:
       u32 target_pc = opd_b->imm;
       int cond = -1;
       int ctaken = 0;
+      int side_exit = 0;
       void *target = NULL;
 
       if (OP_ISBRACND(opd_b->op))
@@ -4974,7 +5381,7 @@ end_op:
 
 #if CALL_STACK
       void *rtsadd = NULL, *rtsret = NULL;
-      if ((opd_b->dest & BITMASK1(SHR_PR)) && pc+2 < end_pc) {
+      if ((opd_b->dest & BITMASK1(SHR_PR)) && i+2 < insn_count) {
         // BSR - save rts data
         tmp = rcache_get_tmp_arg(1);
         rtsadd = tcache_ptr;
@@ -4989,7 +5396,23 @@ end_op:
       // XXX move below cond test if not changing host cond (MIPS delay slot)?
       sr = rcache_get_reg(SHR_SR, RC_GR_RMW, NULL);
       FLUSH_CYCLES(sr);
-      rcache_clean();
+      v = find_in_sorted_linkage(branch_targets, branch_target_count, target_pc);
+#if SUPERBLOCKS
+      // conditional block exit, write back regs only in the taken path. The
+      // inlined exit code must stay small since it may be in a short jump.
+      side_exit = OP_ISBRACND(opd_b->op) && v < 0 &&
+          count_bits(rcache_dirty_mask()) +
+          (drcf.pinning ? count_bits(rcache_regs_pinned) : 0) <= 6;
+#endif
+      if (!side_exit) {
+        rcache_clean();
+#if LOOP_OPTIMIZER
+        tmp = op_idx(target_pc);
+        if (drcf.pinning && (tmp < pinned_loops[pinned_loop_count].idx ||
+                             tmp >= pinned_loops[pinned_loop_count].end || v < 0))
+          rcache_save_pinned(); // leaving the loop, target expects regs in ctx
+#endif
+      }
 
       if (OP_ISBRACND(opd_b->op)) {
         // BT[S], BF[S] - emit condition test
@@ -5011,7 +5434,6 @@ end_op:
         emith_sync_t(sr);
       // no modification of host status/flags between here and branching!
 
-      v = find_in_sorted_linkage(branch_targets, branch_target_count, target_pc);
       if (v >= 0)
       {
         // local branch
@@ -5019,11 +5441,15 @@ end_op:
           // local backward jump, link here now since host PC is already known
           target = branch_targets[v].ptr;
 #if LOOP_OPTIMIZER
-          if (pinned_loops[pinned_loop_count].pc == target_pc) {
-            // backward jump at end of optimized loop
-            rcache_unpin_all();
+          if (pinned_loops[pinned_loop_count].idx == op_idx(target_pc)) {
+            // backward jump to the head of an optimized loop
             target = pinned_loops[pinned_loop_count].ptr;
-            pinned_loop_count ++;
+            if (i + 1 == pinned_loops[pinned_loop_count].end) {
+              // the last one, the loop is left after it
+              rcache_unpin_all();
+              pinned_loop_count ++;
+              drcf.pinning = 0;
+            }
           }
 #endif
           if (cond != -1) {
@@ -5050,16 +5476,44 @@ end_op:
             emith_jump_patchable(target);
             rcache_invalidate();
           }
-        } else
+        } else {
           // no space for resolving forward branch, handle it as external
           dbg(1, "warning: too many unresolved branches");
+#if LOOP_OPTIMIZER
+          if (drcf.pinning)
+            rcache_save_pinned();
+#endif
+        }
       }
 
       if (target == NULL)
       {
         // can't resolve branch locally, make a block exit
         bl = dr_prepare_ext_branch(block->entryp, target_pc, sh2->is_slave, tcache_id);
-        if (cond != -1) {
+        if (side_exit) {
+          // side exit, the main path continues with the unchanged cache state
+          struct rcache_state rcs;
+          EMITH_JMP_START(emith_invert_cond(cond));
+          rcache_save_state(&rcs);
+          rcache_clean();
+#if LOOP_OPTIMIZER
+          if (drcf.pinning)
+            rcache_save_pinned();
+#endif
+          if (bl) {
+            bl->jump = tcache_ptr;
+            emith_flush(); // flush to inhibit insn swapping
+            bl->type = BL_LDJMP;
+          }
+          tmp = rcache_get_tmp_arg(0);
+          emith_move_r_imm(tmp, target_pc);
+          rcache_free_tmp(tmp);
+          target = sh2_drc_dispatcher;
+
+          emith_jump_patchable(target);
+          rcache_restore_state(&rcs);
+          EMITH_JMP_END(emith_invert_cond(cond));
+        } else if (cond != -1) {
 #ifndef __arm__
           if (bl && blx_target_count < ARRAY_SIZE(blx_targets)) {
             // conditional jumps get a blx stub for the far jump
@@ -5100,6 +5554,43 @@ end_op:
           EMITH_SJMP_END(emith_invert_cond(cond));
 #endif
         } else {
+#if SUPERBLOCKS
+          // count BRA exits which might continue as a superblock segment
+          u32 bra_pc = (op_flags[i] & OF_DELAY_OP) ? op_pc(i-1) : 0;
+          if (trace && bra_pc && (FETCH_OP(bra_pc) & 0xf000) == 0xa000 &&
+              block_seg_count < MAX_BLOCK_SEGS &&
+              !(op_flags[i+1] & OF_BTARGET) &&
+              TRACE_EXIT(bra_pc).pc != (bra_pc | 1) &&
+              dr_get_pc_base(target_pc, sh2) == dr_pc_base)
+          {
+            struct trace_exit *te = &TRACE_EXIT(bra_pc);
+            *te = (struct trace_exit) { .pc = bra_pc, .count = TRACE_HOT_COUNT };
+            tmp = rcache_get_tmp();
+            tmp2 = rcache_get_tmp();
+            emith_move_r_ptr_imm(tmp, (uptr)te);
+            emith_read_r_r_offs(tmp2, tmp, offsetof(struct trace_exit, count));
+            emith_sub_r_imm(tmp2, 1);
+            emith_write_r_r_offs(tmp2, tmp, offsetof(struct trace_exit, count));
+            emith_cmp_r_imm(tmp2, 0);
+            rcache_free_tmp(tmp);
+            rcache_free_tmp(tmp2);
+            EMITH_JMP_START(DCOND_GT);
+            tmp4 = rcache_used_hregs_mask();
+            emith_save_caller_regs(tmp4);
+            tmp = rcache_get_tmp_arg(0);
+            emith_move_r_ptr_imm(tmp, (uptr)block);
+            tmp = rcache_get_tmp_arg(1);
+            emith_move_r_imm(tmp, bra_pc);
+            tmp = rcache_get_tmp_arg(2);
+            emith_move_r_imm(tmp, tcache_id);
+            rcache_invalidate_tmp();
+            emith_abicall(sh2_drc_trace_hot);
+            emith_restore_caller_regs(tmp4);
+            EMITH_JMP_END(DCOND_GT);
+            if (bl)
+              bl->jump = tcache_ptr;
+          }
+#endif
           // unconditional, has the far jump inlined
           if (bl) {
             emith_flush(); // flush to inhibit insn swapping
@@ -5129,7 +5620,7 @@ end_op:
         emith_set_t(sr, opd_b->op == OP_BRANCH_CF);
 
       drcf.pending_branch_direct = 0;
-      if (target_pc >= base_pc && target_pc < pc)
+      if ((tmp = op_idx(target_pc)) >= 0 && tmp <= i)
         drcf.polling = drcf.loop_type = 0;
     }
     else if (drcf.pending_branch_indirect) {
@@ -5141,7 +5632,7 @@ end_op:
       struct op_data *opd_b = (op_flags[i] & OF_DELAY_OP) ? opd-1 : opd;
       void *rtsadd = NULL, *rtsret = NULL;
 
-      if ((opd_b->dest & BITMASK1(SHR_PR)) && pc+2 < end_pc) {
+      if ((opd_b->dest & BITMASK1(SHR_PR)) && i+2 < insn_count) {
         // JSR, BSRF - save rts data
         tmp = rcache_get_tmp_arg(1);
         rtsadd = tcache_ptr;
@@ -5645,7 +6136,7 @@ static void sh2_smc_rm_blocks(u32 a, int len, int tcache_id, int free)
   u32 start_addr, end_addr;
   u32 start_lit, end_lit;
   struct block_desc *block;
-  int removed = 0, rest;
+  int removed = 0, rest, s;
 
   // ignore cache-through
   a &= wtmask;
@@ -5661,9 +6152,15 @@ static void sh2_smc_rm_blocks(u32 a, int len, int tcache_id, int free)
       end_addr = start_addr + block->size;
       start_lit = block->addr_lit & wtmask;
       end_lit = start_lit + block->size_lit;
+      // superblock segments
+      for (s = 0; s < ARRAY_SIZE(block->size_seg) && block->size_seg[s]; s++)
+        if ((block->addr_seg[s] & wtmask) < a+len &&
+            a < (block->addr_seg[s] & wtmask) + block->size_seg[s])
+          break;
       // disable/delete block if it covers the modified address
       if ((start_addr < a+len && a < end_addr) ||
-          (start_lit < a+len && a < end_lit))
+          (start_lit < a+len && a < end_lit) ||
+          (s < ARRAY_SIZE(block->size_seg) && block->size_seg[s]))
       {
         dbg(2, "smc remove @%08x", a);
         end_addr = (start_lit < a+len && block->size_lit ? a : 0);
@@ -5682,34 +6179,19 @@ static void sh2_smc_rm_blocks(u32 a, int len, int tcache_id, int free)
     return;
   }
 
-#if BRANCH_CACHE
-  if (tcache_id)
-    memset32(sh2s[tcache_id-1].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
-  else {
-    memset32(sh2s[0].branch_cache, -1, sizeof(sh2s[0].branch_cache)/4);
-    memset32(sh2s[1].branch_cache, -1, sizeof(sh2s[1].branch_cache)/4);
-  }
-#endif
-#if CALL_STACK
-  if (tcache_id) {
-    memset32(sh2s[tcache_id-1].rts_cache, -1, sizeof(sh2s[0].rts_cache)/4);
-    sh2s[tcache_id-1].rts_cache_idx = 0;
-  } else {
-    memset32(sh2s[0].rts_cache, -1, sizeof(sh2s[0].rts_cache)/4);
-    memset32(sh2s[1].rts_cache, -1, sizeof(sh2s[1].rts_cache)/4);
-    sh2s[0].rts_cache_idx = sh2s[1].rts_cache_idx = 0;
-  }
-#endif
+  dr_flush_branch_cache(tcache_id);
 }
 
 void sh2_drc_wcheck_ram(u32 a, unsigned len, SH2 *sh2)
 {
   sh2_smc_rm_blocks(a, len, 0, 0);
+  sh2_pdc_wcheck(a, len, 0);
 }
 
 void sh2_drc_wcheck_da(u32 a, unsigned len, SH2 *sh2)
 {
   sh2_smc_rm_blocks(a, len, 1 + sh2->is_slave, 0);
+  sh2_pdc_wcheck(a, len, 1 + sh2->is_slave);
 }
 
 int sh2_execute_drc(SH2 *sh2c, int cycles)
@@ -5900,6 +6382,14 @@ static void bcache_stats(void)
 #endif
 }
 
+static void memacc_stats(void)
+{
+#if (DRC_DEBUG & 0x1000)
+  printf("inline reads sdram:%d da:%d handler:%d\n", mrhit[0], mrhit[1], mrmiss);
+  printf("inline writes sdram:%d da:%d handler:%d\n", mwhit[0], mwhit[1], mwmiss);
+#endif
+}
+
 void sh2_drc_flush_all(void)
 {
   if (block_tables[0] == NULL)
@@ -5910,9 +6400,11 @@ void sh2_drc_flush_all(void)
   block_stats();
   entry_stats();
   bcache_stats();
+  memacc_stats();
   dr_flush_tcache(0);
   dr_flush_tcache(1);
   dr_flush_tcache(2);
+  memset(trace_exits, 0, sizeof(trace_exits));
   Pico32x.emu_flags &= ~P32XF_DRC_ROM_C;
 }
 
@@ -6091,19 +6583,34 @@ static void *dr_get_pc_base(u32 pc, SH2 *sh2)
   return (char *)ret - (pc & ~mask);
 }
 
+// index in ops[] of a branch target while scanning. Forward targets not yet
+// scanned are expected to be in the current segment.
+static int scan_target_idx(u32 target)
+{
+  struct block_seg *seg = &block_segs[block_seg_count-1];
+  int i = op_idx(target);
+
+  if (i < 0 && target - seg->pc < 2*(BLOCK_INSN_LIMIT - seg->idx))
+    i = seg->idx + (target - seg->pc) / 2;
+  return i;
+}
+
 u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
-  u32 *base_literals_out, u32 *end_literals_out)
+  u32 *base_literals_out, u32 *end_literals_out, int trace)
 {
   u16 *dr_pc_base;
   u32 pc, op, tmp;
   u32 end_pc, end_literals = 0;
   u32 lowest_literal = 0;
   u32 lowest_mova = 0;
+  u32 seg_pc = base_pc;
+  u32 trace_pc = 0; // target of a traced BRA
   struct op_data *opd;
   int next_is_delay = 0;
   int end_block = 0;
   int is_divop;
   int i, i_end, i_div = -1;
+  int s, v;
   u32 crc = 0;
   // 2nd pass stuff
   int last_btarget; // loop detector 
@@ -6111,11 +6618,29 @@ u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
 
   memset(op_flags, 0, sizeof(*op_flags) * BLOCK_INSN_LIMIT);
   op_flags[0] |= OF_BTARGET; // block start is always a target
+  block_segs[0] = (struct block_seg) { .pc = base_pc, .idx = 0 };
+  block_seg_count = 1;
 
   dr_pc_base = dr_get_pc_base(base_pc, &sh2s[!!is_slave]);
 
   // 1st pass: disassemble
   for (i = 0, pc = base_pc; ; i++, pc += 2) {
+    if (trace_pc && !next_is_delay) {
+      // delay slot of a traced BRA done, continue in a segment at its target
+      if ((op_flags[i-1] & OF_B_IN_DS) || i >= BLOCK_INSN_LIMIT - 2)
+        end_block = 1;
+      else {
+        ops[i-2].op = OP_BRANCH_T;
+        // forget targets expected further down in the previous segment
+        memset(op_flags + i, 0, BLOCK_INSN_LIMIT - i);
+        pc = seg_pc = trace_pc;
+        block_segs[block_seg_count++] = (struct block_seg) { .pc = pc, .idx = i };
+        block_segs[block_seg_count].idx = i;
+        lowest_literal = (ops[i-1].op == OP_LOAD_POOL ? ops[i-1].imm : 0);
+        lowest_mova = (ops[i-1].op == OP_MOVA ? ops[i-1].imm : 0);
+      }
+      trace_pc = 0;
+    }
     // we need an ops[] entry after the last one initialized,
     // so do it before end_block checks
     opd = &ops[i];
@@ -6134,6 +6659,9 @@ u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
     else if ((lowest_mova && lowest_mova <= pc) ||
               (lowest_literal && lowest_literal <= pc))
       break; // text area collides with data area
+    else if (block_seg_count > 1 && op_idx(pc) >= 0)
+      break; // segment runs into code already in the block
+    block_segs[block_seg_count].idx = i+1;
 
     is_divop = 0;
     op = FETCH_OP(pc);
@@ -6747,8 +7275,9 @@ u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
         opd->dest = BITMASK1(SHR_PC);
         opd->imm = ((signed int)(op << 24) >> 23);
         opd->imm += pc + 4;
-        if (base_pc <= opd->imm && opd->imm < base_pc + BLOCK_INSN_LIMIT * 2)
-          op_flags[(opd->imm - base_pc) / 2] |= OF_BTARGET;
+        v = scan_target_idx(opd->imm);
+        if (v >= 0)
+          op_flags[v] |= OF_BTARGET;
         break;
       default:
         goto undefined;
@@ -6790,11 +7319,19 @@ u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
       opd->cycles = 2;
       next_is_delay = 1;
       if (!(opd->dest & BITMASK1(SHR_PR))) {
-        if (base_pc <= opd->imm && opd->imm < base_pc + BLOCK_INSN_LIMIT * 2) {
-          op_flags[(opd->imm - base_pc) / 2] |= OF_BTARGET;
-          if (opd->imm <= pc)
+        v = scan_target_idx(opd->imm);
+        if (v >= 0) {
+          op_flags[v] |= OF_BTARGET;
+          if (v <= i)
             end_block = !(op_flags[i+1+next_is_delay] & OF_BTARGET);
-        } else
+        } else if (trace && block_seg_count < MAX_BLOCK_SEGS &&
+            !(op_flags[i] & OF_DELAY_OP) &&
+            !(op_flags[i+1+next_is_delay] & OF_BTARGET) &&
+            TRACE_EXIT(pc).pc == (pc | 1) &&
+            dr_get_pc_base(opd->imm, &sh2s[!!is_slave]) == dr_pc_base)
+          // hot exit, continue the block at the target (superblock)
+          trace_pc = opd->imm;
+        else
           end_block = !(op_flags[i+1+next_is_delay] & OF_BTARGET);
       } else
         op_flags[i+1+next_is_delay] |= OF_BTARGET;
@@ -6841,7 +7378,7 @@ u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
         opd->dest = BITMASK1(SHR_R0);
         if (tmp) {
           opd->imm = (tmp + 2 + (op & 0xff) * 4) & ~3;
-          if (opd->imm >= base_pc) {
+          if (opd->imm >= seg_pc) {
             if (lowest_mova == 0 || opd->imm < lowest_mova)
               lowest_mova = opd->imm;
           }
@@ -6942,7 +7479,13 @@ u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc_out,
   }
 end:
   i_end = i;
-  end_pc = pc;
+  if (block_seg_count > 1 && block_segs[block_seg_count-1].idx == i_end) {
+    // nothing usable at the trace target, the BRA is a block exit after all
+    block_seg_count--;
+    ops[i_end-2].op = OP_BRANCH;
+  }
+  block_segs[block_seg_count].idx = i_end;
+  end_pc = base_pc + 2*block_segs[1].idx;
 
   // 2nd pass: some analysis
   lowest_literal = end_literals = lowest_mova = 0;
@@ -6951,7 +7494,9 @@ end:
   op = 0; // delay/poll insns counter
   is_divop = 0; // divide op insns counter
   i_div = -1; // index of current divide op
-  for (i = 0, pc = base_pc; i < i_end; i++, pc += 2) {
+  for (i = 0, s = 0, pc = base_pc; i < i_end; i++, pc += 2) {
+    if (s+1 < block_seg_count && i == block_segs[s+1].idx)
+      pc = block_segs[++s].pc;
     opd = &ops[i];
     crc += FETCH_OP(pc);
 
@@ -7010,11 +7555,11 @@ end:
         i_div = i;
     }
 
-    // literal pool size detection
-    if (opd->op == OP_MOVA && opd->imm >= base_pc)
+    // literal pool size detection, only for the 1st segment
+    if (opd->op == OP_MOVA && opd->imm >= base_pc && s == 0)
       if (lowest_mova == 0 || opd->imm < lowest_mova)
         lowest_mova = opd->imm;
-    if (opd->op == OP_LOAD_POOL) {
+    if (opd->op == OP_LOAD_POOL && s == 0) {
       if (opd->imm >= base_pc && opd->imm < end_pc + MAX_LITERAL_OFFSET) {
         if (end_literals < opd->imm + opd->size * 2)
           end_literals = opd->imm + opd->size * 2;
@@ -7043,7 +7588,7 @@ end:
     // XXX let's hope nobody is putting a delay or poll insn in a delay slot :-/
     if (OP_ISBRAIMM(opd->op)) {
       // BSR, BRA, BT, BF with immediate target
-      int i_tmp = (opd->imm - base_pc) / 2; // branch target, index in ops
+      int i_tmp = op_idx(opd->imm); // branch target, index in ops
       if (i_tmp == last_btarget) // candidate for basic loop optimizer
         op_flags[i_tmp] |= OF_BASIC_LOOP;
       if (i_tmp == last_btarget && op <= 1) {
@@ -7059,7 +7604,13 @@ end:
       op ++;                    // condition 2 
 #endif
   }
-  end_pc = pc;
+  // drop segments cut off by the overscan detection
+  while (block_seg_count > 1 && block_segs[block_seg_count-1].idx >= i_end) {
+    block_seg_count--;
+    ops[block_segs[block_seg_count].idx - 2].op = OP_BRANCH;
+  }
+  block_segs[block_seg_count].idx = i_end;
+  end_pc = base_pc + 2*block_segs[1].idx;
 
   // end_literals is used to decide to inline a literal or not
   // XXX: need better detection if this actually is used in write
@@ -21,14 +21,14 @@ void sh2_drc_flush_all(void);
 #define OF_B_IN_DS    (1 << 4)
 #define OF_DELAY_INSN (1 << 5) // DT, (TODO ADD+CMP?)
 #define OF_POLL_INSN  (1 << 6) // MOV @(...),Rn (no post increment), TST @(...)
-#define OF_BASIC_LOOP (1 << 7) // pinnable loop without any branches in it
+#define OF_BASIC_LOOP (1 << 7) // head of a loop with pinned regs
 
 #define OF_IDLE_LOOP  (1 << 2)
 #define OF_DELAY_LOOP (2 << 2)
 #define OF_POLL_LOOP  (3 << 2)
 
 u16 scan_block(u32 base_pc, int is_slave, u8 *op_flags, u32 *end_pc,
-		u32 *base_literals, u32 *end_literals);
+		u32 *base_literals, u32 *end_literals, int trace);
 
 #if defined(DRC_SH2) && defined(__GNUC__) && !defined(__clang__)
 // direct access to some host CPU registers used by the DRC if gcc is used.
@@ -1,4 +1,7 @@
 #include "../sh2.h"
+#include <pico/memory.h>
+#undef _USE_CZ80 // HACK
+#include <pico/pico_int.h>
 
 #ifdef DRC_CMP
 #include "../compiler.h"
@@ -42,24 +45,91 @@ static __inline void name(SH2 *sh2, unsigned int a, unsigned int d) \
 	sh2->sr &= 0x3f3; \
 }
 
-MAKE_READFUNC(RB, p32x_sh2_read8)
-MAKE_READFUNC(RW, p32x_sh2_read16)
-MAKE_READFUNC(RL, p32x_sh2_read32)
-MAKE_WRITEFUNC(WB, p32x_sh2_write8)
-MAKE_WRITEFUNC(WW, p32x_sh2_write16)
-MAKE_WRITEFUNC(WL, p32x_sh2_write32)
+MAKE_READFUNC(RB_slow, p32x_sh2_read8)
+MAKE_READFUNC(RW_slow, p32x_sh2_read16)
+MAKE_READFUNC(RL_slow, p32x_sh2_read32)
+MAKE_WRITEFUNC(WB_slow, p32x_sh2_write8)
+MAKE_WRITEFUNC(WW_slow, p32x_sh2_write16)
+MAKE_WRITEFUNC(WL_slow, p32x_sh2_write32)
+
+// SDRAM and data array writes with code or poll addresses need the handlers
+#define W_DIRECT(blk, a, s)	((blk)[(a) >> (s)] == 0)
+#define W_DIRECT_L(blk, a, s)	(((blk)[(a) >> (s)] | (blk)[((a)+2) >> (s)]) == 0)
 
 #else
 
-#define RB(sh2, a) p32x_sh2_read8(a, sh2)
-#define RW(sh2, a) p32x_sh2_read16(a, sh2)
-#define RL(sh2, a) p32x_sh2_read32(a, sh2)
-#define WB(sh2, a, d) p32x_sh2_write8(a, d, sh2)
-#define WW(sh2, a, d) p32x_sh2_write16(a, d, sh2)
-#define WL(sh2, a, d) p32x_sh2_write32(a, d, sh2)
+#define RB_slow(sh2, a) p32x_sh2_read8(a, sh2)
+#define RW_slow(sh2, a) p32x_sh2_read16(a, sh2)
+#define RL_slow(sh2, a) p32x_sh2_read32(a, sh2)
+#define WB_slow(sh2, a, d) p32x_sh2_write8(a, d, sh2)
+#define WW_slow(sh2, a, d) p32x_sh2_write16(a, d, sh2)
+#define WL_slow(sh2, a, d) p32x_sh2_write32(a, d, sh2)
+
+#define W_DIRECT(blk, a, s)	1
+#define W_DIRECT_L(blk, a, s)	1
 
 #endif
 
+// inline fast paths for directly mapped memory, same as in 32x/memory.c
+static __inline UINT32 RB(SH2 *sh2, UINT32 a)
+{
+	const sh2_memmap *m = (const sh2_memmap *)sh2->read8_map + (a >> SH2_READ_SHIFT);
+	if (likely(!map_flag_set(m->addr)))
+		return *(s8 *)((m->addr << 1) + MEM_BE2(a & m->mask));
+	return RB_slow(sh2, a);
+}
+
+static __inline UINT32 RW(SH2 *sh2, UINT32 a)
+{
+	const sh2_memmap *m = (const sh2_memmap *)sh2->read16_map + (a >> SH2_READ_SHIFT);
+	if (likely(!map_flag_set(m->addr)))
+		return *(s16 *)((m->addr << 1) + (a & m->mask));
+	return RW_slow(sh2, a);
+}
+
+static __inline UINT32 RL(SH2 *sh2, UINT32 a)
+{
+	const sh2_memmap *m = (const sh2_memmap *)sh2->read32_map + (a >> SH2_READ_SHIFT);
+	if (likely(!map_flag_set(m->addr))) {
+		u32 *p = (u32 *)((m->addr << 1) + (a & m->mask));
+		return CPU_BE2(*p);
+	}
+	return RL_slow(sh2, a);
+}
+
+#define IS_SDRAM(a)	(((a) & 0xde000000) == 0x06000000)
+#define IS_DA(a)	(((a) & 0xfe000000) == 0xc0000000)
+
+static __inline void WB(SH2 *sh2, UINT32 a, UINT32 d)
+{
+	if (IS_SDRAM(a) && W_DIRECT((u8 *)sh2->p_drcblk_ram, a & 0x3ffff, SH2_DRCBLK_RAM_SHIFT))
+		((u8 *)sh2->p_sdram)[MEM_BE2(a & 0x3ffff)] = d;
+	else if (IS_DA(a) && W_DIRECT((u8 *)sh2->p_drcblk_da, a & 0xfff, SH2_DRCBLK_DA_SHIFT))
+		sh2->data_array[MEM_BE2(a & 0xfff)] = d;
+	else
+		WB_slow(sh2, a, d);
+}
+
+static __inline void WW(SH2 *sh2, UINT32 a, UINT32 d)
+{
+	if (IS_SDRAM(a) && W_DIRECT((u8 *)sh2->p_drcblk_ram, a & 0x3fffe, SH2_DRCBLK_RAM_SHIFT))
+		((u16 *)sh2->p_sdram)[(a & 0x3fffe) / 2] = d;
+	else if (IS_DA(a) && W_DIRECT((u8 *)sh2->p_drcblk_da, a & 0xffe, SH2_DRCBLK_DA_SHIFT))
+		((u16 *)sh2->data_array)[(a & 0xffe) / 2] = d;
+	else
+		WW_slow(sh2, a, d);
+}
+
+static __inline void WL(SH2 *sh2, UINT32 a, UINT32 d)
+{
+	if (IS_SDRAM(a) && W_DIRECT_L((u8 *)sh2->p_drcblk_ram, a & 0x3fffc, SH2_DRCBLK_RAM_SHIFT))
+		*(u32 *)((u8 *)sh2->p_sdram + (a & 0x3fffc)) = CPU_BE2(d);
+	else if (IS_DA(a) && W_DIRECT_L((u8 *)sh2->p_drcblk_da, a & 0xffc, SH2_DRCBLK_DA_SHIFT))
+		*(u32 *)(sh2->data_array + (a & 0xffc)) = CPU_BE2(d);
+	else
+		WL_slow(sh2, a, d);
+}
+
 // some stuff from sh2comn.h
 #define T	0x00000001
 #define S	0x00000002
@@ -109,9 +179,390 @@ static unsigned int op_refs[0x10000];
 
 #ifndef DRC_CMP
 
+/* predecoding: every opcode is mapped to one of these handlers once, and the
+ * interpreter loop dispatches on the handler index. Anything not listed,
+ * which is mostly illegal opcodes, goes through the MAME dispatchers.
+ */
+#ifndef SH2_STATS
+#define PDC_OPS \
+	X(MOVBS0,   0xf00f, 0x0004, MOVBS0(sh2, Rm, Rn)) \
+	X(MOVWS0,   0xf00f, 0x0005, MOVWS0(sh2, Rm, Rn)) \
+	X(MOVLS0,   0xf00f, 0x0006, MOVLS0(sh2, Rm, Rn)) \
+	X(MULL,     0xf00f, 0x0007, MULL(sh2, Rm, Rn)) \
+	X(MOVBL0,   0xf00f, 0x000c, MOVBL0(sh2, Rm, Rn)) \
+	X(MOVWL0,   0xf00f, 0x000d, MOVWL0(sh2, Rm, Rn)) \
+	X(MOVLL0,   0xf00f, 0x000e, MOVLL0(sh2, Rm, Rn)) \
+	X(MAC_L,    0xf00f, 0x000f, MAC_L(sh2, Rm, Rn)) \
+	X(STCSR,    0xf0ff, 0x0002, STCSR(sh2, Rn)) \
+	X(BSRF,     0xf0ff, 0x0003, BSRF(sh2, Rn)) \
+	X(CLRT,     0xffff, 0x0008, CLRT(sh2)) \
+	X(NOP,      0xffff, 0x0009, NOP()) \
+	X(STSMACH,  0xf0ff, 0x000a, STSMACH(sh2, Rn)) \
+	X(RTS,      0xffff, 0x000b, RTS(sh2)) \
+	X(STCGBR,   0xf0ff, 0x0012, STCGBR(sh2, Rn)) \
+	X(SETT,     0xffff, 0x0018, SETT(sh2)) \
+	X(DIV0U,    0xffff, 0x0019, DIV0U(sh2)) \
+	X(STSMACL,  0xf0ff, 0x001a, STSMACL(sh2, Rn)) \
+	X(SLEEP,    0xffff, 0x001b, SLEEP(sh2)) \
+	X(STCVBR,   0xf0ff, 0x0022, STCVBR(sh2, Rn)) \
+	X(BRAF,     0xf0ff, 0x0023, BRAF(sh2, Rn)) \
+	X(CLRMAC,   0xffff, 0x0028, CLRMAC(sh2)) \
+	X(MOVT,     0xf0ff, 0x0029, MOVT(sh2, Rn)) \
+	X(STSPR,    0xf0ff, 0x002a, STSPR(sh2, Rn)) \
+	X(RTE,      0xffff, 0x002b, RTE(sh2)) \
+	X(MOVLS4,   0xf000, 0x1000, MOVLS4(sh2, Rm, opcode & 0x0f, Rn)) \
+	X(MOVBS,    0xf00f, 0x2000, MOVBS(sh2, Rm, Rn)) \
+	X(MOVWS,    0xf00f, 0x2001, MOVWS(sh2, Rm, Rn)) \
+	X(MOVLS,    0xf00f, 0x2002, MOVLS(sh2, Rm, Rn)) \
+	X(MOVBM,    0xf00f, 0x2004, MOVBM(sh2, Rm, Rn)) \
+	X(MOVWM,    0xf00f, 0x2005, MOVWM(sh2, Rm, Rn)) \
+	X(MOVLM,    0xf00f, 0x2006, MOVLM(sh2, Rm, Rn)) \
+	X(DIV0S,    0xf00f, 0x2007, DIV0S(sh2, Rm, Rn)) \
+	X(TST,      0xf00f, 0x2008, TST(sh2, Rm, Rn)) \
+	X(AND,      0xf00f, 0x2009, AND(sh2, Rm, Rn)) \
+	X(XOR,      0xf00f, 0x200a, XOR(sh2, Rm, Rn)) \
+	X(OR,       0xf00f, 0x200b, OR(sh2, Rm, Rn)) \
+	X(CMPSTR,   0xf00f, 0x200c, CMPSTR(sh2, Rm, Rn)) \
+	X(XTRCT,    0xf00f, 0x200d, XTRCT(sh2, Rm, Rn)) \
+	X(MULU,     0xf00f, 0x200e, MULU(sh2, Rm, Rn)) \
+	X(MULS,     0xf00f, 0x200f, MULS(sh2, Rm, Rn)) \
+	X(CMPEQ,    0xf00f, 0x3000, CMPEQ(sh2, Rm, Rn)) \
+	X(CMPHS,    0xf00f, 0x3002, CMPHS(sh2, Rm, Rn)) \
+	X(CMPGE,    0xf00f, 0x3003, CMPGE(sh2, Rm, Rn)) \
+	X(DIV1,     0xf00f, 0x3004, DIV1(sh2, Rm, Rn)) \
+	X(DMULU,    0xf00f, 0x3005, DMULU(sh2, Rm, Rn)) \
+	X(CMPHI,    0xf00f, 0x3006, CMPHI(sh2, Rm, Rn)) \
+	X(CMPGT,    0xf00f, 0x3007, CMPGT(sh2, Rm, Rn)) \
+	X(SUB,      0xf00f, 0x3008, SUB(sh2, Rm, Rn)) \
+	X(SUBC,     0xf00f, 0x300a, SUBC(sh2, Rm, Rn)) \
+	X(SUBV,     0xf00f, 0x300b, SUBV(sh2, Rm, Rn)) \
+	X(ADD,      0xf00f, 0x300c, ADD(sh2, Rm, Rn)) \
+	X(DMULS,    0xf00f, 0x300d, DMULS(sh2, Rm, Rn)) \
+	X(ADDC,     0xf00f, 0x300e, ADDC(sh2, Rm, Rn)) \
+	X(ADDV,     0xf00f, 0x300f, ADDV(sh2, Rm, Rn)) \
+	X(SHLL,     0xf0ff, 0x4000, SHLL(sh2, Rn)) \
+	X(SHLR,     0xf0ff, 0x4001, SHLR(sh2, Rn)) \
+	X(STSMMACH, 0xf0ff, 0x4002, STSMMACH(sh2, Rn)) \
+	X(STCMSR,   0xf0ff, 0x4003, STCMSR(sh2, Rn)) \
+	X(ROTL,     0xf0ff, 0x4004, ROTL(sh2, Rn)) \
+	X(ROTR,     0xf0ff, 0x4005, ROTR(sh2, Rn)) \
+	X(LDSMMACH, 0xf0ff, 0x4006, LDSMMACH(sh2, Rn)) \
+	X(LDCMSR,   0xf0ff, 0x4007, LDCMSR(sh2, Rn)) \
+	X(SHLL2,    0xf0ff, 0x4008, SHLL2(sh2, Rn)) \
+	X(SHLR2,    0xf0ff, 0x4009, SHLR2(sh2, Rn)) \
+	X(LDSMACH,  0xf0ff, 0x400a, LDSMACH(sh2, Rn)) \
+	X(JSR,      0xf0ff, 0x400b, JSR(sh2, Rn)) \
+	X(LDCSR,    0xf0ff, 0x400e, LDCSR(sh2, Rn)) \
+	X(MAC_W,    0xf00f, 0x400f, MAC_W(sh2, Rm, Rn)) \
+	X(DT,       0xf0ff, 0x4010, DT(sh2, Rn)) \
+	X(CMPPZ,    0xf0ff, 0x4011, CMPPZ(sh2, Rn)) \
+	X(STSMMACL, 0xf0ff, 0x4012, STSMMACL(sh2, Rn)) \
+	X(STCMGBR,  0xf0ff, 0x4013, STCMGBR(sh2, Rn)) \
+	X(CMPPL,    0xf0ff, 0x4015, CMPPL(sh2, Rn)) \
+	X(LDSMMACL, 0xf0ff, 0x4016, LDSMMACL(sh2, Rn)) \
+	X(LDCMGBR,  0xf0ff, 0x4017, LDCMGBR(sh2, Rn)) \
+	X(SHLL8,    0xf0ff, 0x4018, SHLL8(sh2, Rn)) \
+	X(SHLR8,    0xf0ff, 0x4019, SHLR8(sh2, Rn)) \
+	X(LDSMACL,  0xf0ff, 0x401a, LDSMACL(sh2, Rn)) \
+	X(TAS,      0xf0ff, 0x401b, TAS(sh2, Rn)) \
+	X(LDCGBR,   0xf0ff, 0x401e, LDCGBR(sh2, Rn)) \
+	X(SHAL,     0xf0ff, 0x4020, SHAL(sh2, Rn)) \
+	X(SHAR,     0xf0ff, 0x4021, SHAR(sh2, Rn)) \
+	X(STSMPR,   0xf0ff, 0x4022, STSMPR(sh2, Rn)) \
+	X(STCMVBR,  0xf0ff, 0x4023, STCMVBR(sh2, Rn)) \
+	X(ROTCL,    0xf0ff, 0x4024, ROTCL(sh2, Rn)) \
+	X(ROTCR,    0xf0ff, 0x4025, ROTCR(sh2, Rn)) \
+	X(LDSMPR,   0xf0ff, 0x4026, LDSMPR(sh2, Rn)) \
+	X(LDCMVBR,  0xf0ff, 0x4027, LDCMVBR(sh2, Rn)) \
+	X(SHLL16,   0xf0ff, 0x4028, SHLL16(sh2, Rn)) \
+	X(SHLR16,   0xf0ff, 0x4029, SHLR16(sh2, Rn)) \
+	X(LDSPR,    0xf0ff, 0x402a, LDSPR(sh2, Rn)) \
+	X(JMP,      0xf0ff, 0x402b, JMP(sh2, Rn)) \
+	X(LDCVBR,   0xf0ff, 0x402e, LDCVBR(sh2, Rn)) \
+	X(MOVLL4,   0xf000, 0x5000, MOVLL4(sh2, Rm, opcode & 0x0f, Rn)) \
+	X(MOVBL,    0xf00f, 0x6000, MOVBL(sh2, Rm, Rn)) \
+	X(MOVWL,    0xf00f, 0x6001, MOVWL(sh2, Rm, Rn)) \
+	X(MOVLL,    0xf00f, 0x6002, MOVLL(sh2, Rm, Rn)) \
+	X(MOV,      0xf00f, 0x6003, MOV(sh2, Rm, Rn)) \
+	X(MOVBP,    0xf00f, 0x6004, MOVBP(sh2, Rm, Rn)) \
+	X(MOVWP,    0xf00f, 0x6005, MOVWP(sh2, Rm, Rn)) \
+	X(MOVLP,    0xf00f, 0x6006, MOVLP(sh2, Rm, Rn)) \
+	X(NOT,      0xf00f, 0x6007, NOT(sh2, Rm, Rn)) \
+	X(SWAPB,    0xf00f, 0x6008, SWAPB(sh2, Rm, Rn)) \
+	X(SWAPW,    0xf00f, 0x6009, SWAPW(sh2, Rm, Rn)) \
+	X(NEGC,     0xf00f, 0x600a, NEGC(sh2, Rm, Rn)) \
+	X(NEG,      0xf00f, 0x600b, NEG(sh2, Rm, Rn)) \
+	X(EXTUB,    0xf00f, 0x600c, EXTUB(sh2, Rm, Rn)) \
+	X(EXTUW,    0xf00f, 0x600d, EXTUW(sh2, Rm, Rn)) \
+	X(EXTSB,    0xf00f, 0x600e, EXTSB(sh2, Rm, Rn)) \
+	X(EXTSW,    0xf00f, 0x600f, EXTSW(sh2, Rm, Rn)) \
+	X(ADDI,     0xf000, 0x7000, ADDI(sh2, opcode & 0xff, Rn)) \
+	X(MOVBS4,   0xff00, 0x8000, MOVBS4(sh2, opcode & 0x0f, Rm)) \
+	X(MOVWS4,   0xff00, 0x8100, MOVWS4(sh2, opcode & 0x0f, Rm)) \
+	X(MOVBL4,   0xff00, 0x8400, MOVBL4(sh2, Rm, opcode & 0x0f)) \
+	X(MOVWL4,   0xff00, 0x8500, MOVWL4(sh2, Rm, opcode & 0x0f)) \
+	X(CMPIM,    0xff00, 0x8800, CMPIM(sh2, opcode & 0xff)) \
+	X(BT,       0xff00, 0x8900, BT(sh2, opcode & 0xff)) \
+	X(BF,       0xff00, 0x8b00, BF(sh2, opcode & 0xff)) \
+	X(BTS,      0xff00, 0x8d00, BTS(sh2, opcode & 0xff)) \
+	X(BFS,      0xff00, 0x8f00, BFS(sh2, opcode & 0xff)) \
+	X(MOVWI,    0xf000, 0x9000, MOVWI(sh2, opcode & 0xff, Rn)) \
+	X(BRA,      0xf000, 0xa000, BRA(sh2, opcode & 0xfff)) \
+	X(BSR,      0xf000, 0xb000, BSR(sh2, opcode & 0xfff)) \
+	X(MOVBSG,   0xff00, 0xc000, MOVBSG(sh2, opcode & 0xff)) \
+	X(MOVWSG,   0xff00, 0xc100, MOVWSG(sh2, opcode & 0xff)) \
+	X(MOVLSG,   0xff00, 0xc200, MOVLSG(sh2, opcode & 0xff)) \
+	X(TRAPA,    0xff00, 0xc300, TRAPA(sh2, opcode & 0xff)) \
+	X(MOVBLG,   0xff00, 0xc400, MOVBLG(sh2, opcode & 0xff)) \
+	X(MOVWLG,   0xff00, 0xc500, MOVWLG(sh2, opcode & 0xff)) \
+	X(MOVLLG,   0xff00, 0xc600, MOVLLG(sh2, opcode & 0xff)) \
+	X(MOVA,     0xff00, 0xc700, MOVA(sh2, opcode & 0xff)) \
+	X(TSTI,     0xff00, 0xc800, TSTI(sh2, opcode & 0xff)) \
+	X(ANDI,     0xff00, 0xc900, ANDI(sh2, opcode & 0xff)) \
+	X(XORI,     0xff00, 0xca00, XORI(sh2, opcode & 0xff)) \
+	X(ORI,      0xff00, 0xcb00, ORI(sh2, opcode & 0xff)) \
+	X(TSTM,     0xff00, 0xcc00, TSTM(sh2, opcode & 0xff)) \
+	X(ANDM,     0xff00, 0xcd00, ANDM(sh2, opcode & 0xff)) \
+	X(XORM,     0xff00, 0xce00, XORM(sh2, opcode & 0xff)) \
+	X(ORM,      0xff00, 0xcf00, ORM(sh2, opcode & 0xff)) \
+	X(MOVLI,    0xf000, 0xd000, MOVLI(sh2, opcode & 0xff, Rn)) \
+	X(MOVI,     0xf000, 0xe000, MOVI(sh2, opcode & 0xff, Rn))
+#else
+// keep everything in the dispatchers, they do the statistics
+#define PDC_OPS
+#endif
+
+enum {
+#define X(name, mask, match, code) PO_##name,
+	PDC_OPS
+#undef X
+	PO_GENERIC
+};
+
+static const struct { UINT16 mask, match; } pdc_optab[] = {
+#define X(name, mask, match, code) { mask, match },
+	PDC_OPS
+#undef X
+	{ 0, 1 } // never matches
+};
+
+static u8 pdc_decode[0x10000];
+static int pdc_decode_done;
+
+static void pdc_decode_init(void)
+{
+	int op, i;
+
+	pdc_decode_done = 1;
+	for (op = 0; op < 0x10000; op++) {
+		pdc_decode[op] = PO_GENERIC;
+		for (i = 0; i < sizeof(pdc_optab) / sizeof(pdc_optab[0]); i++)
+			if ((op & pdc_optab[i].mask) == pdc_optab[i].match) {
+				pdc_decode[op] = i;
+				break;
+			}
+	}
+}
+
+#ifdef DRC_SH2
+
+/* decoded instruction cache, per cpu. One line holds one SH2 cache line
+ * (16 bytes) of SDRAM, ROM, BIOS or data array code. SDRAM and data array
+ * lines are counted in the DRC's drcblk maps, so that writes to them end up
+ * in sh2_drc_wcheck_*, which invalidates the lines again.
+ */
+#define PDC_LINES	4096
+
+struct pdc_insn { UINT16 op, h; };
+struct pdc_line {
+	UINT32 tag;
+	struct pdc_insn i[8];
+};
+
+static struct pdc_cpu {
+	struct pdc_line *cur;	// line the cpu is currently executing from
+	UINT32 cur_pc;		// its address as seen by the cpu, -1 if none
+	struct pdc_line *lines;
+} pdc[2];
+
+#define PDC_IDX(tag)	(((tag) >> 4) & (PDC_LINES-1))
+
+// canonical address of the line containing a, -1 if code there isn't cached
+static UINT32 pdc_tag(UINT32 a)
+{
+	a &= ~0x2000000f; // ignore cache-through
+
+	if ((a & 0xfe000000) == 0x06000000)	// SDRAM
+		return 0x06000000 | (a & 0x3fff0);
+	if ((a & 0xfe000000) == 0xc0000000)	// data array
+		return 0xc0000000 | (a & 0xff0);
+	if ((a & 0xfe000000) == 0x02000000)	// ROM
+		return a;
+	if (a < 0x800)				// BIOS
+		return a;
+	return -1;
+}
+
+static u8 *pdc_blk(UINT32 tag, int cpu)
+{
+	if ((tag & 0xfe000000) == 0x06000000)
+		return Pico32xMem->drcblk_ram + ((tag & 0x3ffff) >> SH2_DRCBLK_RAM_SHIFT);
+	if ((tag & 0xfe000000) == 0xc0000000)
+		return Pico32xMem->drcblk_da[cpu] + ((tag & 0xfff) >> SH2_DRCBLK_DA_SHIFT);
+	return NULL;
+}
+
+static void pdc_mark(UINT32 tag, int cpu, int mark)
+{
+	u8 *p = pdc_blk(tag, cpu);
+	int i;
+
+	if (p != NULL)
+		for (i = 0; i < 16 >> SH2_DRCBLK_RAM_SHIFT; i++)
+			p[i] += mark;
+}
+
+static struct pdc_line *pdc_fill(SH2 *sh2, UINT32 a)
+{
+	struct pdc_cpu *pc = &pdc[sh2->is_slave];
+	struct pdc_line *l;
+	UINT32 tag, mask;
+	u16 *p;
+	int i;
+
+	tag = pdc_tag(a);
+	if (tag == -1)
+		return NULL;
+	if (pc->lines == NULL) {
+		pc->lines = malloc(PDC_LINES * sizeof(*pc->lines));
+		if (pc->lines == NULL)
+			return NULL;
+		for (i = 0; i < PDC_LINES; i++)
+			pc->lines[i].tag = -1;
+	}
+
+	l = &pc->lines[PDC_IDX(tag)];
+	if (l->tag == tag)
+		return l;
+
+	p = p32x_sh2_get_mem_ptr(tag, &mask, sh2);
+	if (p == (void *)-1)
+		return NULL;
+	p = (u16 *)((u8 *)p + (tag & mask));
+
+	if (l->tag != -1)
+		pdc_mark(l->tag, sh2->is_slave, -1);
+	for (i = 0; i < 8; i++) {
+		l->i[i].op = p[i];
+		l->i[i].h = pdc_decode[p[i]];
+	}
+	l->tag = tag;
+	pdc_mark(tag, sh2->is_slave, 1);
+	if ((tag & 0xfe000000) == 0x02000000)
+		Pico32x.emu_flags |= P32XF_DRC_ROM_C; // banking must flush
+
+	return l;
+}
+
+void sh2_pdc_wcheck(u32 a, unsigned len, int tcache_id)
+{
+	struct pdc_line *l;
+	UINT32 tag, end = a + len;
+	int cpu;
+
+	for (a &= ~15; a < end; a += 16) {
+		tag = pdc_tag(a);
+		if (tag == -1)
+			continue;
+		for (cpu = 0; cpu < 2; cpu++) {
+			if ((tcache_id && cpu != tcache_id - 1) || pdc[cpu].lines == NULL)
+				continue;
+			l = &pdc[cpu].lines[PDC_IDX(tag)];
+			if (l->tag != tag)
+				continue;
+			pdc_mark(tag, cpu, -1);
+			l->tag = -1;
+			if (pdc[cpu].cur == l)
+				pdc[cpu].cur_pc = -1;
+		}
+	}
+}
+
+// the DRC has cleared its block maps, drop the lines counted there
+void sh2_pdc_flush(int tcache_id)
+{
+	int cpu, i;
+
+	for (cpu = 0; cpu < 2; cpu++) {
+		if (pdc[cpu].lines == NULL)
+			continue;
+		for (i = 0; i < PDC_LINES; i++) {
+			UINT32 tag = pdc[cpu].lines[i].tag;
+			if ((tag & 0xfe000000) != 0xc0000000 || cpu == tcache_id - 1)
+				pdc[cpu].lines[i].tag = -1;
+		}
+		pdc[cpu].cur_pc = -1;
+	}
+}
+
+void sh2_pdc_finish(SH2 *sh2)
+{
+	struct pdc_cpu *pc = &pdc[sh2->is_slave];
+
+	free(pc->lines);
+	pc->lines = NULL;
+	pc->cur_pc = -1;
+}
+
+// opcode at a, from the decoded line if there's one
+#define PDC_FETCH(sh2, a, opcode, h) { \
+	struct pdc_cpu *pc_ = &pdc[sh2->is_slave]; \
+	if (unlikely(((a) & ~15) != pc_->cur_pc)) { \
+		pc_->cur = pdc_fill(sh2, a); \
+		pc_->cur_pc = (a) & ~15; \
+	} \
+	if (likely(pc_->cur != NULL)) { \
+		struct pdc_insn *e_ = &pc_->cur->i[((a) >> 1) & 7]; \
+		opcode = e_->op, h = e_->h; \
+	} else { \
+		opcode = (UINT16)RW(sh2, a); \
+		h = pdc_decode[opcode]; \
+	} \
+}
+
+#else
+
+#define PDC_FETCH(sh2, a, opcode, h) { \
+	opcode = (UINT16)RW(sh2, a); \
+	h = pdc_decode[opcode]; \
+}
+
+#endif // DRC_SH2
+
+#ifdef __GNUC__
+#define PDC_DISPATCH(h)	goto *pdc_labels[h];
+#define PDC_CASE(name)	pdc_##name:
+#define PDC_END
+#else
+#define PDC_DISPATCH(h)	switch (h) {
+#define PDC_CASE(name)	case PO_##name:
+#define PDC_END		}
+#endif
+
 int sh2_execute_interpreter(SH2 *sh2, int cycles)
 {
-	UINT32 opcode;
+#ifdef __GNUC__
+	static const void *const pdc_labels[] = {
+#define X(name, mask, match, code) &&pdc_##name,
+		PDC_OPS
+#undef X
+		&&pdc_GENERIC
+	};
+#endif
+	UINT32 opcode, a, h;
+
+	if (unlikely(!pdc_decode_done))
+		pdc_decode_init();
 
 	sh2->icount = cycles;
 
@@ -122,8 +573,8 @@ int sh2_execute_interpreter(SH2 *sh2, int cycles)
 	{
 		if (sh2->delay)
 		{
-			sh2->ppc = sh2->delay;
-			opcode = (UINT32)(UINT16)RW(sh2, sh2->delay);
+			sh2->ppc = a = sh2->delay;
+			PDC_FETCH(sh2, a, opcode, h);
 
 			// TODO: more branch types
 			if ((opcode >> 13) == 5) { // BRA/BSR
@@ -133,20 +584,25 @@ int sh2_execute_interpreter(SH2 *sh2, int cycles)
 				WL(sh2, sh2->r[15], sh2->pc);
 				sh2->pc = RL(sh2, sh2->vbr + 6 * 4);
 				sh2->icount -= 5;
-				opcode = 9; // NOP
+				opcode = 9, h = pdc_decode[9]; // NOP
 			}
 
 			sh2->pc -= 2;
 		}
 		else
 		{
-			sh2->ppc = sh2->pc;
-			opcode = (UINT32)(UINT16)RW(sh2, sh2->pc);
+			sh2->ppc = a = sh2->pc;
+			PDC_FETCH(sh2, a, opcode, h);
 		}
 
 		sh2->delay = 0;
 		sh2->pc += 2;
 
+		PDC_DISPATCH(h)
+#define X(name, mask, match, code) PDC_CASE(name) code; goto next;
+		PDC_OPS
+#undef X
+		PDC_CASE(GENERIC)
 		switch ((opcode >> 12) & 15)
 		{
 		case  0: op0000(sh2, opcode); break;
@@ -166,7 +622,8 @@ int sh2_execute_interpreter(SH2 *sh2, int cycles)
 		case 14: op1110(sh2, opcode); break;
 		default: op1111(sh2, opcode); break;
 		}
-
+		PDC_END
+next:
 		sh2->icount--;
 
 		if (sh2->test_irq && !sh2->delay)
@@ -218,7 +675,7 @@ int sh2_execute_interpreter(SH2 *sh2, int cycles)
 			if (sh2->pc < *base_pc || sh2->pc >= *end_pc) {
 				*base_pc = sh2->pc;
 				scan_block(*base_pc, sh2->is_slave,
-					op_flags, end_pc, NULL, NULL);
+					op_flags, end_pc, NULL, NULL, 0);
 			}
 			if ((op_flags[(sh2->pc - *base_pc) / 2]
 				& OF_BTARGET) || sh2->pc == *base_pc
@@ -37,6 +37,7 @@ void sh2_finish(SH2 *sh2)
 {
 #ifdef DRC_SH2
 	sh2_drc_finish(sh2);
+	sh2_pdc_finish(sh2);
 #endif
 }
 
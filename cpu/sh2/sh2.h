@@ -109,6 +109,17 @@ void sh2_unpack(SH2 *sh2, const unsigned char *buff);
 int  sh2_execute_drc(SH2 *sh2c, int cycles);
 int  sh2_execute_interpreter(SH2 *sh2c, int cycles);
 
+// decoded insn cache of the interpreter, kept coherent by the DRC's SMC checks
+#if defined(DRC_SH2) && !defined(DRC_CMP)
+void sh2_pdc_wcheck(u32 a, unsigned len, int tcache_id);
+void sh2_pdc_flush(int tcache_id);
+void sh2_pdc_finish(SH2 *sh2);
+#else
+#define sh2_pdc_wcheck(a, len, tcache_id)
+#define sh2_pdc_flush(tcache_id)
+#define sh2_pdc_finish(sh2)
+#endif
+
 static __inline void sh2_execute_prepare(SH2 *sh2, int use_drc)
 {
 #ifdef DRC_SH2
@@ -15,6 +15,8 @@ SH2 sh2s[2];
 
 #define SH2_IDLE_STATES (SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL|SH2_STATE_SLEEP)
 
+static void sync_sh2s_reset(void);
+
 static int REGPARM(2) sh2_irq_cb(SH2 *sh2, int level)
 {
   if (sh2->pending_irl > sh2->pending_int_irq) {
@@ -123,6 +125,7 @@ void Pico32xStartup(void)
 
   PicoMemSetup32x();
   p32x_pwm_ctl_changed();
+  sync_sh2s_reset();
 
   Pico32x.regs[0] |= P32XS_ADEN;
 
@@ -211,8 +214,11 @@ void p32x_reset_sh2s(void)
   msh2.m68krcycles_done = ssh2.m68krcycles_done = SekCyclesDone();
 }
 
+static struct pico_events p32x_events;
+
 void Pico32xInit(void)
 {
+  pevents_register(&p32x_events);
 }
 
 void PicoPower32x(void)
@@ -245,6 +251,7 @@ void PicoReset32x(void)
     p32x_m68k_poll_event(0, -1);
     p32x_sh2_poll_event(msh2.poll_addr, &msh2, SH2_IDLE_STATES, Pico.t.m68c_aim);
     p32x_sh2_poll_event(ssh2.poll_addr, &ssh2, SH2_IDLE_STATES, Pico.t.m68c_aim);
+    sync_sh2s_reset();
   }
 }
 
@@ -388,31 +395,50 @@ static void stimer_event(unsigned int now)
   p32x_timer_irq(&ssh2, now);
 }
 
-typedef void (event_cb)(unsigned int now);
+static void mdma0_event(unsigned int now)
+{
+  p32x_dmac_event(&msh2, 0, now);
+}
+
+static void mdma1_event(unsigned int now)
+{
+  p32x_dmac_event(&msh2, 1, now);
+}
+
+static void sdma0_event(unsigned int now)
+{
+  p32x_dmac_event(&ssh2, 0, now);
+}
+
+static void sdma1_event(unsigned int now)
+{
+  p32x_dmac_event(&ssh2, 1, now);
+}
 
 /* times are in m68k (7.6MHz) cycles */
 unsigned int p32x_event_times[P32X_EVENT_COUNT];
-static unsigned int event_time_next;
-static event_cb *p32x_event_cbs[P32X_EVENT_COUNT] = {
+static event_cb * const p32x_event_cbs[P32X_EVENT_COUNT] = {
   p32x_pwm_irq_event, // P32X_EVENT_PWM
   fillend_event,      // P32X_EVENT_FILLEND
   hint_event,         // P32X_EVENT_HINT
   mtimer_event,       // P32X_EVENT_MTIMER
   stimer_event,       // P32X_EVENT_STIMER
+  mdma0_event,        // P32X_EVENT_MDMA0
+  mdma1_event,        // P32X_EVENT_MDMA1
+  sdma0_event,        // P32X_EVENT_SDMA0
+  sdma1_event,        // P32X_EVENT_SDMA1
+};
+static struct pico_events p32x_events = {
+  p32x_event_times, p32x_event_cbs, P32X_EVENT_COUNT, 0, EL_32X, "32x",
+  PAHW_32X, NULL
 };
+#define event_time_next p32x_events.next
 
 // schedule event at some time 'after', in m68k clocks
 void p32x_event_schedule(unsigned int now, enum p32x_event event, int after)
 {
-  unsigned int when;
-
-  when = (now + after) | 1;
-
-  elprintf(EL_32X, "32x: new event #%u %u->%u", event, now, when);
-  p32x_event_times[event] = when;
-
-  if (event_time_next == 0 || CYCLES_GT(event_time_next, when))
-    event_time_next = when;
+  // NB (0,0) would cancel the event, it ends up at time 1 in that case
+  pevents_schedule(&p32x_events, now, event, (now|after) ? after : 1);
 }
 
 void p32x_event_schedule_sh2(SH2 *sh2, enum p32x_event event, int after)
@@ -435,41 +461,7 @@ void p32x_event_schedule_sh2(SH2 *sh2, enum p32x_event event, int after)
 
 static void p32x_run_events(unsigned int until)
 {
-  int oldest, oldest_diff, time;
-  int i, diff;
-
-  while (1) {
-    oldest = -1, oldest_diff = 0x7fffffff;
-
-    for (i = 0; i < P32X_EVENT_COUNT; i++) {
-      if (p32x_event_times[i]) {
-        diff = p32x_event_times[i] - until;
-        if (diff < oldest_diff) {
-          oldest_diff = diff;
-          oldest = i;
-        }
-      }
-    }
-
-    if (oldest_diff <= 0) {
-      time = p32x_event_times[oldest];
-      p32x_event_times[oldest] = 0;
-      elprintf(EL_32X, "32x: run event #%d %u", oldest, time);
-      p32x_event_cbs[oldest](time);
-    }
-    else if (oldest_diff < 0x7fffffff) {
-      event_time_next = p32x_event_times[oldest];
-      break;
-    }
-    else {
-      event_time_next = 0;
-      break;
-    }
-  }
-
-  if (oldest != -1)
-    elprintf(EL_32X, "32x: next event #%d at %u",
-      oldest, event_time_next);
+  pevents_run(&p32x_events, until);
 }
 
 static void run_sh2(SH2 *sh2, unsigned int m68k_cycles)
@@ -482,7 +474,10 @@ static void run_sh2(SH2 *sh2, unsigned int m68k_cycles)
   elprintf_sh2(sh2, EL_32X, "+run %u %d @%08x",
     sh2->m68krcycles_done, cycles, sh2->pc);
 
+  pstats_start();
   done = sh2_execute(sh2, cycles);
+  pstats_end(PSTATS_MSH2 + sh2->is_slave);
+  pstats_add(PSTATS_MSH2 + sh2->is_slave, run, done);
 
   sh2->m68krcycles_done += C_SH2_TO_M68K(sh2, done);
   sh2->state &= ~SH2_STATE_RUN;
@@ -491,6 +486,9 @@ static void run_sh2(SH2 *sh2, unsigned int m68k_cycles)
     sh2->m68krcycles_done, done);
 }
 
+// incremented whenever the cpus interact (comm ports, polling, forced syncs)
+unsigned int p32x_sync_events;
+
 // sync other sh2 to this one
 // note: recursive call
 void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
@@ -498,6 +496,9 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
   SH2 *osh2 = sh2->other_sh2;
   int left_to_event;
   int m68k_cycles;
+  unsigned int t0;
+
+  p32x_sync_events++;
 
   if (osh2->state & SH2_STATE_RUN) {
     sh2_end_run(sh2, 0);
@@ -509,6 +510,8 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
     return;
 
   if (osh2->state & SH2_IDLE_STATES) {
+    pstats_add(PSTATS_MSH2 + osh2->is_slave, idle,
+      C_M68K_TO_SH2(osh2, m68k_cycles));
     osh2->m68krcycles_done = m68k_target;
     return;
   }
@@ -516,7 +519,12 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
   elprintf_sh2(osh2, EL_32X, "sync to %u %d",
     m68k_target, m68k_cycles);
 
+  pstats_cur.sync.resyncs++;
+  pstats_cur.sync.resync_cycles += m68k_cycles;
+  t0 = pstats_clock ? pstats_clock() : 0;
   run_sh2(osh2, m68k_cycles);
+  if (pstats_clock)
+    pstats_cur.sync.resync_us += pstats_clock() - t0;
 
   // there might be new event to schedule current sh2 to
   if (event_time_next) {
@@ -530,7 +538,20 @@ void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target)
 }
 
 #define STEP_LS 24
-#define STEP_N 192 // NFL; TODO at least a scanline (489) for good performance?
+// adaptive slice length. Starts at STEP_MIN (NFL needs that), and grows up to
+// about a scanline while the cpus run without interacting with each other.
+#define STEP_MIN 192
+#define STEP_MAX 488
+static int step_n = STEP_MIN;
+static unsigned int step_events;
+
+// start over with short slices. Done at each frame start too, since the slice
+// state isn't saved and must not differ after loading a state at that point
+static void sync_sh2s_reset(void)
+{
+  step_n = STEP_MIN;
+  step_events = p32x_sync_events;
+}
 
 #define sync_sh2s_normal p32x_sync_sh2s
 //#define sync_sh2s_lockstep p32x_sync_sh2s
@@ -564,8 +585,8 @@ void sync_sh2s_normal(unsigned int m68k_target)
     while (CYCLES_GT(target, now))
     {
       next = target;
-      if (CYCLES_GT(target, now + STEP_N))
-        next = now + STEP_N;
+      if (CYCLES_GT(target, now + step_n))
+        next = now + step_n;
       elprintf(EL_32X, "sh2 exec to %u %d,%d/%d, flags %x", next,
         next - msh2.m68krcycles_done, next - ssh2.m68krcycles_done,
         m68k_target - now, Pico32x.emu_flags);
@@ -598,6 +619,15 @@ void sync_sh2s_normal(unsigned int m68k_target)
       }
       pprof_end(msh2);
 
+      // shrink the slice on interaction, else grow it by 50%
+      if (step_events != p32x_sync_events) {
+        step_events = p32x_sync_events;
+        step_n = STEP_MIN;
+      } else if (step_n < STEP_MAX)
+        step_n = step_n + step_n / 2 < STEP_MAX ? step_n + step_n / 2 : STEP_MAX;
+      pstats_cur.sync.slices++;
+      pstats_cur.sync.slice_cycles += next - now;
+
       now = next;
       if (CYCLES_GT(now, msh2.m68krcycles_done)) {
         if (!(msh2.state & SH2_IDLE_STATES))
@@ -613,12 +643,18 @@ void sync_sh2s_normal(unsigned int m68k_target)
 
   // advance idle CPUs
   if (msh2.state & SH2_IDLE_STATES) {
-    if (CYCLES_GT(m68k_target, msh2.m68krcycles_done))
+    if (CYCLES_GT(m68k_target, msh2.m68krcycles_done)) {
+      pstats_add(PSTATS_MSH2, idle,
+        C_M68K_TO_SH2(&msh2, m68k_target - msh2.m68krcycles_done));
       msh2.m68krcycles_done = m68k_target;
+    }
   }
   if (ssh2.state & SH2_IDLE_STATES) {
-    if (CYCLES_GT(m68k_target, ssh2.m68krcycles_done))
+    if (CYCLES_GT(m68k_target, ssh2.m68krcycles_done)) {
+      pstats_add(PSTATS_SSH2, idle,
+        C_M68K_TO_SH2(&ssh2, m68k_target - ssh2.m68krcycles_done));
       ssh2.m68krcycles_done = m68k_target;
+    }
   }
 }
 
@@ -660,6 +696,7 @@ void PicoFrame32x(void)
 
   PicoFrameStart();
   Pico32x.sync_line = 0;
+  sync_sh2s_reset();
   if (Pico32xDrawMode != PDM32X_BOTH)
     Pico.est.rendstatus |= PDRAW_SYNC_NEEDED;
   PicoFrameHints();
@@ -690,7 +727,7 @@ void Pico32xSetClocks(int msh2_hz, int ssh2_hz)
 void Pico32xStateLoaded(int is_early)
 {
   if (is_early) {
-    Pico32xMemStateLoaded();
+    Pico32xMemStateLoaded(0);
     return;
   }
 
@@ -700,12 +737,17 @@ void Pico32xStateLoaded(int is_early)
   p32x_update_irls(NULL, Pico.t.m68c_aim);
   sh2_peripheral_state_loaded();
   p32x_pwm_state_loaded();
-  p32x_run_events(Pico.t.m68c_aim);
+  pevents_reset(&p32x_events, Pico.t.m68c_aim);
 
   // TODO wakeup CPUs for now. poll detection stuff must go to the save state!
   p32x_m68k_poll_event(0, -1);
   p32x_sh2_poll_event(msh2.poll_addr, &msh2, SH2_IDLE_STATES, msh2.m68krcycles_done);
   p32x_sh2_poll_event(ssh2.poll_addr, &ssh2, SH2_IDLE_STATES, ssh2.m68krcycles_done);
+  // ..but keep those stalled by a DMA whose end event is still pending
+  if (p32x_dmac_busy(&msh2))
+    msh2.state |= SH2_STATE_SLEEP;
+  if (p32x_dmac_busy(&ssh2))
+    ssh2.state |= SH2_STATE_SLEEP;
 }
 
 void Pico32xPrepare(void)
@@ -279,6 +279,50 @@ static const do_loop_func do_loop_dc_f[] = { do_loop_dc, do_loop_dc_h32, do_loop
 static const do_loop_func do_loop_pp_f[] = { do_loop_pp, do_loop_pp_h32, do_loop_pp_md, do_loop_pp_scan, do_loop_pp_scan_h32, do_loop_pp_scan_md };
 static const do_loop_func do_loop_rl_f[] = { do_loop_rl, do_loop_rl_h32, do_loop_rl_md, do_loop_rl_scan, do_loop_rl_scan_h32, do_loop_rl_scan_md };
 
+// reuse an output line if both the 32X line table entry and the MD layer are
+// the same as for the previous line, e.g. for vertically scaled 32X images.
+// Only if the MD layer is merged here, since in 16bit mode it's already in the
+// target buffer. The other lines are drawn in runs by the (C or asm) loop.
+// Define CHECK_32X_LINE_REUSE to draw reused lines too and compare the result
+static void do_loop_md_reuse(do_loop_func do_loop, unsigned short *dst,
+    unsigned short *dram, unsigned lines_sft_offs, int md_bg)
+{
+  unsigned char  *pmd = Pico.est.Draw2FB + 328 * (lines_sft_offs & 0xff) + 8;
+  unsigned short *ltab = dram + (lines_sft_offs >> 24);
+  unsigned short *prev;
+  int lines = (lines_sft_offs >> 16) & 0xff;
+  int incr = DrawLineDestIncrement32x / 2;
+  int l, start = 0;
+
+  // draw lines start..end-1
+#define draw_run(end) \
+  do_loop(dst + start * incr, dram, (lines_sft_offs & 0x0300) + \
+    (((lines_sft_offs >> 24) + start) << 24) + (((end) - start) << 16) + \
+    (lines_sft_offs & 0xff) + start, md_bg)
+
+  if (lines_sft_offs & (2<<8)) pmd += H32_OFFSET;
+  for (l = 1; l < lines; l++) {
+    if (ltab[l] != ltab[l - 1] || memcmp(pmd + 328 * l, pmd + 328 * (l - 1), 320))
+      continue;
+    if (l > start)
+      draw_run(l);
+    prev = dst + (l - 1) * incr;
+#ifdef CHECK_32X_LINE_REUSE
+    start = l;
+    draw_run(l + 1);
+    if (memcmp(dst + l * incr, prev, 320 * 2))
+      elprintf(EL_STATUS|EL_ANOMALY, "32x: reused line %d differs",
+        (lines_sft_offs & 0xff) + l);
+#else
+    memcpy(dst + l * incr, prev, 320 * 2);
+#endif
+    start = l + 1;
+  }
+  if (lines > start)
+    draw_run(lines);
+#undef draw_run
+}
+
 void PicoDraw32xLayer(int offs, int lines, int md_bg)
 {
   int have_scan = PicoScan32xBegin != NULL && PicoScan32xEnd != NULL;
@@ -333,7 +377,11 @@ do_it:
   if (!(Pico.video.reg[12] & 1)) // offset flag for H32
     lines_sft_offs |= 2 << 8;
 
-  do_loop[which_func](Pico.est.DrawLineDest, dram, lines_sft_offs, md_bg);
+  if (which_func == DO_LOOP_MD)
+    do_loop_md_reuse(do_loop[which_func], Pico.est.DrawLineDest, dram,
+      lines_sft_offs, md_bg);
+  else
+    do_loop[which_func](Pico.est.DrawLineDest, dram, lines_sft_offs, md_bg);
 }
 
 // mostly unused, games tend to keep 32X layer on
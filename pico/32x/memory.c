@@ -133,6 +133,7 @@ void NOINLINE p32x_sh2_poll_detect(u32 a, SH2 *sh2, u32 flags, int maxcnt)
 
       sh2->state |= flags;
       sh2_end_run(sh2, 0);
+      p32x_sync_events++;
       pevt_log_sh2(sh2, EVT_POLL_START);
 #ifdef DRC_SH2
       // mark this as an address used for polling if SDRAM
@@ -165,6 +166,7 @@ void NOINLINE p32x_sh2_poll_event(u32 a, SH2 *sh2, u32 flags, u32 m68k_cycles)
 
     pevt_log_sh2_o(sh2, EVT_POLL_END);
     sh2->state &= ~flags;
+    p32x_sync_events++;
   }
 
   if (!(sh2->state & (SH2_STATE_CPOLL|SH2_STATE_VPOLL|SH2_STATE_RPOLL)))
@@ -173,6 +175,7 @@ void NOINLINE p32x_sh2_poll_event(u32 a, SH2 *sh2, u32 flags, u32 m68k_cycles)
 
 static NOINLINE void sh2s_sync_on_read(SH2 *sh2, unsigned cycles)
 {
+  p32x_sync_events++;
   if (sh2->poll_cnt != 0)
     return;
 
@@ -529,6 +532,7 @@ static void p32x_reg_write8(u32 a, u32 d)
 
         if (REG8IN16(r, a) != (u8)d) {
           REG8IN16(r, a) = d;
+          p32x_sync_events++;
           p32x_sh2_poll_event(a, &sh2s[0], SH2_STATE_CPOLL, cycles);
           p32x_sh2_poll_event(a, &sh2s[1], SH2_STATE_CPOLL, cycles);
           sh2_poll_write(a & ~1, r[a / 2], cycles, NULL);
@@ -632,6 +636,7 @@ static void p32x_reg_write16(u32 a, u32 d)
 
         if (r[a / 2] != (u16)d) {
           r[a / 2] = d;
+          p32x_sync_events++;
           p32x_sh2_poll_event(a, &sh2s[0], SH2_STATE_CPOLL, cycles);
           p32x_sh2_poll_event(a, &sh2s[1], SH2_STATE_CPOLL, cycles);
           sh2_poll_write(a, (u16)d, cycles, NULL);
@@ -1638,6 +1643,7 @@ static void sh2_sdram_poll(u32 a, u32 d, SH2 *sh2)
 
   DRC_SAVE_SR(sh2);
   cycles = sh2_cycles_done_m68k(sh2);
+  p32x_sync_events++; // communication through SDRAM
   sh2_poll_write(a, d, cycles, sh2);
   p32x_sh2_poll_event(a, sh2->other_sh2, SH2_STATE_RPOLL, cycles);
   if (p32x_sh2_ready(sh2->other_sh2, cycles+8))
@@ -2525,10 +2531,12 @@ void p32x_update_banks(void)
     sh2_drc_flush_all();
 }
 
-void Pico32xMemStateLoaded(void)
+void Pico32xMemStateLoaded(int flags)
 {
-  bank_switch_rom_68k(Pico32x.regs[4 / 2]);
-  Pico32xSwapDRAM((Pico32x.vdp_regs[0x0a / 2] & P32XV_FS) ^ P32XV_FS);
+  if (!(flags & PSL_MAPS_OK)) {
+    bank_switch_rom_68k(Pico32x.regs[4 / 2]);
+    Pico32xSwapDRAM((Pico32x.vdp_regs[0x0a / 2] & P32XV_FS) ^ P32XV_FS);
+  }
   memset(Pico32xMem->pwm, 0, sizeof(Pico32xMem->pwm));
   Pico32x.dirty_pal = 1;
 
@@ -2539,7 +2547,39 @@ void Pico32xMemStateLoaded(void)
   ssh2.poll_addr = ssh2.poll_cycles = ssh2.poll_cnt = 0;
   memset(sh2_poll_fifo, 0, sizeof(sh2_poll_fifo));
 
-  sh2_drc_flush_all();
+  // stale code has already been dropped by p32x_sh2_ram_restore() if fast
+  if (!(flags & PSL_FAST))
+    sh2_drc_flush_all();
+}
+
+// copy SH2 RAM from a state, dropping translated code only in pages which
+// differ. id is 0 for SDRAM, 1 and 2 for the master and slave data arrays.
+void p32x_sh2_ram_restore(int id, const void *src)
+{
+  u8 *dst = id ? sh2s[id - 1].data_array : Pico32xMem->sdram;
+  int len = id ? sizeof(sh2s[0].data_array) : sizeof(Pico32xMem->sdram);
+#ifdef DRC_SH2
+  const u8 *s = src;
+  int i, start = -1;
+
+  for (i = 0; i <= len; i += 0x100) {
+    if (i < len && memcmp(dst + i, s + i, 0x100)) {
+      if (start < 0)
+        start = i;
+      continue;
+    }
+    if (start < 0)
+      continue;
+    memcpy(dst + start, s + start, i - start);
+    if (id)
+      sh2_drc_wcheck_da(0xc0000000 + start, i - start, &sh2s[id - 1]);
+    else
+      sh2_drc_wcheck_ram(0x06000000 + start, i - start, NULL);
+    start = -1;
+  }
+#else
+  memcpy(dst, src, len);
+#endif
 }
 
 // vim:shiftwidth=2:ts=2:expandtab
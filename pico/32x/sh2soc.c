@@ -74,63 +74,84 @@ static void dmac_te_irq(SH2 *sh2, struct dma_chan *chan)
     sh2_internal_irq(sh2, level, vector & 0x7f);
 }
 
-static void dmac_transfer_complete(SH2 *sh2, struct dma_chan *chan)
+// is an auto-request transfer still running on any channel of this SH2?
+int p32x_dmac_busy(SH2 *sh2)
+{
+  int ev = P32X_EVENT_MDMA0 + 2*sh2->is_slave;
+  return p32x_event_times[ev] || p32x_event_times[ev + 1];
+}
+
+static void dmac_transfer_complete(SH2 *sh2, struct dma_chan *chan,
+  unsigned int m68k_cycles)
 {
   u32 a = sh2->poll_addr;
+  int wake = SH2_STATE_CPOLL;
   chan->chcr |= DMA_TE; // DMA has ended normally
 
-  // wake SLEEP and CPOLL since xRick has a loop polling on both TE and COMM
-  p32x_sh2_poll_event(a, sh2, SH2_STATE_SLEEP|SH2_STATE_CPOLL, SekCyclesDone());
+  // wake SLEEP and CPOLL since xRick has a loop polling on both TE and COMM.
+  // The bus stays busy as long as the other channel is still transferring
+  if (!p32x_dmac_busy(sh2))
+    wake |= SH2_STATE_SLEEP;
+  p32x_sh2_poll_event(a, sh2, wake, m68k_cycles);
   if (chan->chcr & DMA_IE)
     dmac_te_irq(sh2, chan);
 }
 
-static void dmac_transfer_one(SH2 *sh2, struct dma_chan *chan)
+// address step per unit for the SM/DM bits: 0 fixed, 1 increment, 2 decrement
+#define DMAC_STEP(mode, size) \
+  (((int)((mode) & 1) - (int)(((mode) >> 1) & 1)) * (size))
+
+// bulk transfer of count units, in all address modes. 16 byte units always
+// increment the source and are counted in words in tcr.
+static void dmac_transfer(SH2 *sh2, struct dma_chan *chan, int count)
 {
-  u32 size, d;
+  u32 size = (chan->chcr >> 10) & 3;
+  u32 sar = chan->sar, dar = chan->dar;
+  int sstep, dstep, n;
+  u32 d;
 
-  size = (chan->chcr >> 10) & 3;
-  switch (size) {
-  case 0:
-    d = p32x_sh2_read8(chan->sar, sh2);
-    p32x_sh2_write8(chan->dar, d, sh2);
-    break;
-  case 1:
-    d = p32x_sh2_read16(chan->sar, sh2);
-    p32x_sh2_write16(chan->dar, d, sh2);
-    break;
-  case 2:
-    d = p32x_sh2_read32(chan->sar, sh2);
-    p32x_sh2_write32(chan->dar, d, sh2);
-    break;
-  case 3:
-    d = p32x_sh2_read32(chan->sar + 0x00, sh2);
-    p32x_sh2_write32(chan->dar + 0x00, d, sh2);
-    d = p32x_sh2_read32(chan->sar + 0x04, sh2);
-    p32x_sh2_write32(chan->dar + 0x04, d, sh2);
-    d = p32x_sh2_read32(chan->sar + 0x08, sh2);
-    p32x_sh2_write32(chan->dar + 0x08, d, sh2);
-    d = p32x_sh2_read32(chan->sar + 0x0c, sh2);
-    p32x_sh2_write32(chan->dar + 0x0c, d, sh2);
-    chan->sar += 16; // always?
-    if (chan->chcr & (1 << 15))
-      chan->dar -= 16;
-    if (chan->chcr & (1 << 14))
-      chan->dar += 16;
-    chan->tcr -= 4;
-    return;
+  if (size == 3) {
+    dstep = DMAC_STEP(chan->chcr >> 14, 16);
+    for (n = count; n > 0; n--, sar += 16, dar += dstep) {
+      d = p32x_sh2_read32(sar + 0x00, sh2);
+      p32x_sh2_write32(dar + 0x00, d, sh2);
+      d = p32x_sh2_read32(sar + 0x04, sh2);
+      p32x_sh2_write32(dar + 0x04, d, sh2);
+      d = p32x_sh2_read32(sar + 0x08, sh2);
+      p32x_sh2_write32(dar + 0x08, d, sh2);
+      d = p32x_sh2_read32(sar + 0x0c, sh2);
+      p32x_sh2_write32(dar + 0x0c, d, sh2);
+    }
+    chan->tcr -= count * 4;
+    if ((int)chan->tcr < 0)
+      chan->tcr = 0; // tcr wasn't a multiple of 4
+  } else {
+    sstep = DMAC_STEP(chan->chcr >> 12, 1 << size);
+    dstep = DMAC_STEP(chan->chcr >> 14, 1 << size);
+    switch (size) {
+    case 0:
+      for (n = count; n > 0; n--, sar += sstep, dar += dstep) {
+        d = p32x_sh2_read8(sar, sh2);
+        p32x_sh2_write8(dar, d, sh2);
+      }
+      break;
+    case 1:
+      for (n = count; n > 0; n--, sar += sstep, dar += dstep) {
+        d = p32x_sh2_read16(sar, sh2);
+        p32x_sh2_write16(dar, d, sh2);
+      }
+      break;
+    case 2:
+      for (n = count; n > 0; n--, sar += sstep, dar += dstep) {
+        d = p32x_sh2_read32(sar, sh2);
+        p32x_sh2_write32(dar, d, sh2);
+      }
+      break;
+    }
+    chan->tcr -= count;
   }
-  chan->tcr--;
-
-  size = 1 << size;
-  if (chan->chcr & (1 << 15))
-    chan->dar -= size;
-  if (chan->chcr & (1 << 14))
-    chan->dar += size;
-  if (chan->chcr & (1 << 13))
-    chan->sar -= size;
-  if (chan->chcr & (1 << 12))
-    chan->sar += size;
+  chan->sar = sar;
+  chan->dar = dar;
 }
 
 // optimization for copying around memory with SH2 DMA
@@ -152,6 +173,19 @@ static void dmac_memcpy(struct dma_chan *chan, SH2 *sh2)
   chan->tcr -= count;
 }
 
+// end of an auto-request transfer on a channel, after all units were moved
+void p32x_dmac_event(SH2 *sh2, int ch, unsigned int now)
+{
+  struct dmac *dmac = (void *)&sh2->peri_regs[0x180 / 4];
+  struct dma_chan *chan = &dmac->chan[ch];
+
+  if ((chan->chcr & (DMA_AR|DMA_TE|DMA_DE)) == (DMA_AR|DMA_DE) &&
+      chan->tcr == 0)
+    dmac_transfer_complete(sh2, chan, now);
+  else if (!p32x_dmac_busy(sh2)) // channel was stopped, don't stall forever
+    p32x_sh2_poll_event(sh2->poll_addr, sh2, SH2_STATE_SLEEP, now);
+}
+
 // DMA trigger by SH2 register write
 static void dmac_trigger(SH2 *sh2, struct dma_chan *chan)
 {
@@ -160,16 +194,34 @@ static void dmac_trigger(SH2 *sh2, struct dma_chan *chan)
   chan->tcr &= 0xffffff;
 
   if (chan->chcr & DMA_AR) {
-    // auto-request transfer
-    sh2->state |= SH2_STATE_SLEEP;
+    // auto-request transfer. Data is moved at once, the SH2 is halted until
+    // the time the transfer would have taken has passed.
+    struct dmac *dmac = (void *)&sh2->peri_regs[0x180 / 4];
+    u32 tcr = chan->tcr, size = (chan->chcr >> 10) & 3;
+    int ch = (chan != &dmac->chan[0]);
+    int ev = P32X_EVENT_MDMA0 + 2*sh2->is_slave + ch;
+    int oev = P32X_EVENT_MDMA0 + 2*sh2->is_slave + !ch;
+    int cycles, after;
+
     if ((((chan->chcr >> 12) ^ (chan->chcr >> 14)) & 3) == 0 &&
         (((chan->chcr >> 14) ^ (chan->chcr >> 15)) & 1) == 1) {
       // SM == DM and either DM0 or DM1 are set. check for mem to mem copy
       dmac_memcpy(chan, sh2);
     }
-    while ((int)chan->tcr > 0)
-      dmac_transfer_one(sh2, chan);
-    dmac_transfer_complete(sh2, chan);
+    if (chan->tcr > 0)
+      dmac_transfer(sh2, chan, size == 3 ? (chan->tcr + 3) / 4 : chan->tcr);
+    // a read and a write bus cycle per word or smaller unit
+    cycles = (tcr - chan->tcr) * 2;
+
+    // the other channel may still be busy, transfers are done in sequence.
+    // Each channel has its own end event, so TE and irq come at its own end
+    after = C_SH2_TO_M68K(sh2, cycles);
+    if (p32x_event_times[oev] &&
+        CYCLES_GT(p32x_event_times[oev], sh2_cycles_done_m68k(sh2)))
+      after += p32x_event_times[oev] - sh2_cycles_done_m68k(sh2);
+    p32x_event_schedule_sh2(sh2, ev, after);
+    sh2->state |= SH2_STATE_SLEEP;
+    sh2_end_run(sh2, 0);
     return;
   }
 
@@ -561,9 +613,24 @@ static void dreq0_do(SH2 *sh2, struct dma_chan *chan)
   // HACK: assume bus is busy and SH2 is halted
   sh2->state |= SH2_STATE_SLEEP;
 
-  for (i = 0; i < Pico32x.dmac0_fifo_ptr && chan->tcr > 0; i++) {
-    elprintf_sh2(sh2, EL_32XP, "dreq0 [%08x] %04x, dreq_len %d",
-      chan->dar, Pico32x.dmac_fifo[i], dreqlen);
+  elprintf_sh2(sh2, EL_32XP, "dreq0 [%08x] %d words, dreq_len %d",
+    chan->dar, Pico32x.dmac0_fifo_ptr, dreqlen);
+  i = 0;
+  if ((chan->dar & 2) && Pico32x.dmac0_fifo_ptr > 0 && chan->tcr > 0) {
+    p32x_sh2_write16(chan->dar, Pico32x.dmac_fifo[i++], sh2);
+    chan->dar += 2;
+    chan->tcr--;
+  }
+  // word pairs to memory can be moved as longwords
+  if ((chan->dar & 0xc5000000) == 0x04000000) {
+    for (; i + 1 < Pico32x.dmac0_fifo_ptr && chan->tcr > 1; i += 2) {
+      p32x_sh2_write32(chan->dar,
+        (Pico32x.dmac_fifo[i] << 16) | Pico32x.dmac_fifo[i+1], sh2);
+      chan->dar += 4;
+      chan->tcr -= 2;
+    }
+  }
+  for (; i < Pico32x.dmac0_fifo_ptr && chan->tcr > 0; i++) {
     p32x_sh2_write16(chan->dar, Pico32x.dmac_fifo[i], sh2);
     chan->dar += 2;
     chan->tcr--;
@@ -576,7 +643,7 @@ static void dreq0_do(SH2 *sh2, struct dma_chan *chan)
 
   Pico32x.regs[6 / 2] &= ~P32XS_FULL;
   if (chan->tcr == 0)
-    dmac_transfer_complete(sh2, chan);
+    dmac_transfer_complete(sh2, chan, SekCyclesDone());
   else
     sh2_end_run(sh2, 16);
 }
@@ -590,10 +657,10 @@ static void dreq1_do(SH2 *sh2, struct dma_chan *chan)
     elprintf(EL_32XP|EL_ANOMALY, "dreq1: bad dar?: %08x\n", chan->dar);
 
   sh2->state |= SH2_STATE_SLEEP;
-  dmac_transfer_one(sh2, chan);
+  dmac_transfer(sh2, chan, 1);
   sh2->state &= ~SH2_STATE_SLEEP;
   if (chan->tcr == 0)
-    dmac_transfer_complete(sh2, chan);
+    dmac_transfer_complete(sh2, chan, SekCyclesDone());
 }
 
 void p32x_dreq0_trigger(void)
@@ -19,7 +19,14 @@
 #include <unzip/unzip.h>
 #include <zlib.h>
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 static int rom_alloc_size;
+static int rom_mapped;  // ROM is a private (COW) mapping of the media file
 static const char *rom_exts[] = { "bin", "gen", "smd", "md", "32x", "pco", "iso", "sms", "gg", "sg", "sc" };
 
 void (*PicoCartUnloadHook)(void);
@@ -34,9 +41,11 @@ static void PicoCartDetect(const char *carthw_cfg);
 static void PicoCartDetectMS(void);
 
 /* cso struct */
+#define CSO_READAHEAD (16*2048) // consecutive compressed blocks read at once
+
 typedef struct _cso_struct
 {
-  unsigned char in_buff[2*2048];
+  unsigned char in_buff[CSO_READAHEAD];
   unsigned char out_buff[2048];
   struct {
     char          magic[4];
@@ -50,36 +59,57 @@ typedef struct _cso_struct
   } header;
   unsigned int  fpos_in;  // input file read pointer
   unsigned int  fpos_out; // pos in virtual decompressed file
-  int block_in_buff;      // block which we have read in in_buff
-  int pad;
+  unsigned int  buff_pos; // file offset of in_buff contents
+  unsigned int  buff_len; // amount of data in in_buff
+  int block_in_buff;      // block which we have decompressed in out_buff
+  z_stream stream;        // reused for all blocks to avoid inflate setup
   int index[0];
 }
 cso_struct;
 
-static int uncompress_buf(void *dest, int destLen, void *source, int sourceLen)
+// decompress a block to dst, reading ahead following blocks from the file
+static int cso_read_block(cso_struct *cso, FILE *f, int block, void *dst)
 {
-    z_stream stream;
-    int err;
-
-    stream.next_in = (Bytef*)source;
-    stream.avail_in = (uInt)sourceLen;
-    stream.next_out = dest;
-    stream.avail_out = (uInt)destLen;
-
-    stream.zalloc = NULL;
-    stream.zfree = NULL;
+  unsigned int index = cso->index[block];
+  unsigned int index_end = cso->index[block+1];
+  unsigned int read_pos = (index&0x7fffffff) << cso->header.align;
+  unsigned int read_len = 2048;
+  int ret;
 
-    err = inflateInit2(&stream, -15);
-    if (err != Z_OK) return err;
+  if (!(index & 0x80000000))
+    read_len = (((index_end&0x7fffffff) << cso->header.align) - read_pos) & 0xfff;
 
-    err = inflate(&stream, Z_FINISH);
-    if (err != Z_STREAM_END) {
-        inflateEnd(&stream);
-        return err;
+  if (read_pos < cso->buff_pos || read_pos+read_len > cso->buff_pos+cso->buff_len)
+  {
+    if (read_pos != cso->fpos_in)
+      fseek(f, read_pos, SEEK_SET);
+    ret = fread(cso->in_buff, 1, sizeof(cso->in_buff), f);
+    cso->fpos_in = read_pos + ret;
+    cso->buff_pos = read_pos;
+    cso->buff_len = ret;
+    if (ret < read_len) {
+      elprintf(EL_STATUS, "cso: read failed @ %08x", read_pos);
+      return -1;
     }
-    //*destLen = stream.total_out;
+  }
+
+  if (index & 0x80000000) {
+    // uncompressed block
+    memcpy(dst, cso->in_buff + read_pos - cso->buff_pos, 2048);
+    return 0;
+  }
 
-    return inflateEnd(&stream);
+  inflateReset(&cso->stream);
+  cso->stream.next_in = cso->in_buff + read_pos - cso->buff_pos;
+  cso->stream.avail_in = read_len;
+  cso->stream.next_out = dst;
+  cso->stream.avail_out = 2048;
+  ret = inflate(&cso->stream, Z_FINISH);
+  if (ret != Z_STREAM_END) {
+    elprintf(EL_STATUS, "cso: uncompress failed @ %08x with %i", read_pos, ret);
+    return -1;
+  }
+  return 0;
 }
 
 static const char *get_ext(const char *path)
@@ -102,21 +132,230 @@ struct zip_file {
   struct zipent *entry;
   z_stream stream;
   unsigned char inbuf[16384];
+  unsigned char *map;   // if mapped, inflate directly from the zip file
   long start;
   unsigned int pos;
 };
 
+#ifdef HAVE_MMAP
+static void *pm_mmap_path(const char *path, size_t length)
+{
+  void *ptr;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  ptr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  return ptr != MAP_FAILED ? ptr : NULL;
+}
+#endif
+
+static void zip_rewind(struct zip_file *z)
+{
+  if (z->map != NULL) {
+    z->stream.next_in = z->map + z->start;
+    z->stream.avail_in = z->entry->compressed_size;
+  } else {
+    fseek(z->zip->fp, z->start, SEEK_SET);
+    z->stream.next_in = z->inbuf;
+    z->stream.avail_in = 0;
+  }
+}
+
+#ifdef HAVE_MMAP
+// read-only file mapping for uncompressed files, established on first use.
+// pages are shared with the page cache and other processes using the file.
+struct file_map {
+  int fd;
+  unsigned char *data;
+};
+#endif
+
 #if defined(USE_LIBCHDR)
+// process wide cache of decompressed CHD hunks. Images are identified by
+// their SHA1, so all handles for the same image share one chd_file and its
+// hunks. Hunks are evicted in LRU order if the cache exceeds its budget.
+// The default budget is small, frontends may raise it by pm_set_cache_size.
+#ifndef PM_CHD_CACHE_SIZE
+#if defined(__GP2X__) || defined(PSP) || defined(__PSP__) || defined(__PS2__)
+#define PM_CHD_CACHE_SIZE (512*1024)
+#else
+#define PM_CHD_CACHE_SIZE (4*1024*1024)
+#endif
+#endif
+
+struct chd_hunk {
+  struct chd_hunk *prev, *next; // LRU list, most recently used first
+  struct chd_image *img;
+  int hunknum;
+  u8 data[0];
+};
+
+struct chd_image {
+  struct chd_image *next;
+  chd_file *chd;
+  u8 sha1[CHD_SHA1_BYTES];
+  char *path; // if sha1 is unset, as for CHD v1/v2
+  int refcount;
+  int hunkbytes;
+  int totalhunks;
+  struct chd_hunk **hunks;
+};
+
+static struct {
+  struct chd_image *images;
+  struct chd_hunk *head, *tail;
+  size_t size, limit;
+} chd_cache = { .limit = PM_CHD_CACHE_SIZE };
+
 struct chd_struct {
   pm_file file;
   int fpos;
   int sectorsize;
-  chd_file *chd;
+  struct chd_image *img;
   int unitbytes;
   int hunkunits;
-  u8 *hunk;
-  int hunknum;
 };
+
+static void chd_hunk_unlink(struct chd_hunk *h)
+{
+  if (h->prev) h->prev->next = h->next;
+  else chd_cache.head = h->next;
+  if (h->next) h->next->prev = h->prev;
+  else chd_cache.tail = h->prev;
+}
+
+static void chd_hunk_free(struct chd_hunk *h)
+{
+  chd_hunk_unlink(h);
+  h->img->hunks[h->hunknum] = NULL;
+  chd_cache.size -= h->img->hunkbytes;
+  free(h);
+}
+
+static void chd_cache_trim(size_t limit)
+{
+  while (chd_cache.tail != NULL && chd_cache.size > limit)
+    chd_hunk_free(chd_cache.tail);
+}
+
+void pm_set_cache_size(size_t bytes)
+{
+  chd_cache.limit = bytes;
+  chd_cache_trim(bytes);
+}
+
+static const u8 *chd_get_hunk(struct chd_image *img, int hunknum)
+{
+  struct chd_hunk *h;
+
+  if (hunknum < 0 || hunknum >= img->totalhunks)
+    return NULL;
+
+  h = img->hunks[hunknum];
+  if (h != NULL) {
+    // move to front of LRU list
+    if (h != chd_cache.head) {
+      chd_hunk_unlink(h);
+      h->prev = NULL;
+      h->next = chd_cache.head;
+      chd_cache.head->prev = h;
+      chd_cache.head = h;
+    }
+    return h->data;
+  }
+
+  // always keep at least the hunk being read
+  chd_cache_trim(chd_cache.limit > img->hunkbytes ?
+                 chd_cache.limit - img->hunkbytes : 0);
+  h = malloc(sizeof(*h) + img->hunkbytes);
+  if (h == NULL)
+    return NULL;
+  if (chd_read(img->chd, hunknum, h->data) != CHDERR_NONE) {
+    elprintf(EL_STATUS, "chd: read failed for hunk %d", hunknum);
+    free(h);
+    return NULL;
+  }
+  h->img = img;
+  h->hunknum = hunknum;
+  h->prev = NULL;
+  h->next = chd_cache.head;
+  if (chd_cache.head) chd_cache.head->prev = h;
+  else chd_cache.tail = h;
+  chd_cache.head = h;
+  chd_cache.size += img->hunkbytes;
+  img->hunks[hunknum] = h;
+  return h->data;
+}
+
+static struct chd_image *chd_image_get(chd_file *cf, const char *path)
+{
+  static const u8 nosha1[CHD_SHA1_BYTES];
+  const chd_header *head = chd_get_header(cf);
+  struct chd_image *img;
+
+  // no SHA1 in old headers, fall back to the path
+  if (memcmp(head->sha1, nosha1, sizeof(nosha1)) != 0)
+    path = NULL;
+
+  for (img = chd_cache.images; img != NULL; img = img->next) {
+    if (img->hunkbytes == head->hunkbytes && img->totalhunks == head->totalhunks
+        && memcmp(img->sha1, head->sha1, sizeof(img->sha1)) == 0
+        && (path == NULL || strcmp(img->path, path) == 0)) {
+      // already open, share it
+      chd_close(cf);
+      img->refcount++;
+      return img;
+    }
+  }
+
+  img = calloc(1, sizeof(*img));
+  if (img == NULL)
+    return NULL;
+  img->hunks = calloc(head->totalhunks, sizeof(img->hunks[0]));
+  if (path != NULL)
+    img->path = strdup(path);
+  if (img->hunks == NULL || (path != NULL && img->path == NULL)) {
+    free(img->hunks);
+    free(img);
+    return NULL;
+  }
+  img->chd = cf;
+  memcpy(img->sha1, head->sha1, sizeof(img->sha1));
+  img->refcount = 1;
+  img->hunkbytes = head->hunkbytes;
+  img->totalhunks = head->totalhunks;
+  img->next = chd_cache.images;
+  chd_cache.images = img;
+  return img;
+}
+
+static void chd_image_put(struct chd_image *img)
+{
+  struct chd_image **pp;
+  int i;
+
+  if (--img->refcount > 0)
+    return;
+
+  for (i = 0; i < img->totalhunks; i++)
+    if (img->hunks[i] != NULL)
+      chd_hunk_free(img->hunks[i]);
+  for (pp = &chd_cache.images; *pp != NULL; pp = &(*pp)->next)
+    if (*pp == img) {
+      *pp = img->next;
+      break;
+    }
+  chd_close(img->chd);
+  free(img->hunks);
+  free(img->path);
+  free(img);
+}
+#else
+void pm_set_cache_size(size_t bytes)
+{
+}
 #endif
 
 pm_file *pm_open(const char *path)
@@ -170,6 +409,11 @@ found_rom_zip:
       zfile->zip = zipfile;
       zfile->entry = zipentry;
       zfile->start = ftell(zipfile->fp);
+#ifdef HAVE_MMAP
+      if (zipentry->compression_method != 0)
+        zfile->map = pm_mmap_path(path, zfile->start + zipentry->compressed_size);
+#endif
+      zip_rewind(zfile);
       zfile->file.file = zfile;
       zfile->file.size = zipentry->uncompressed_size;
       zfile->file.type = PMT_ZIP;
@@ -214,6 +458,10 @@ zip_failed:
       elprintf(EL_STATUS, "cso: bad block size (%u)", cso->header.block_size);
       goto cso_failed;
     }
+    if (cso->header.align > 20) {
+      elprintf(EL_STATUS, "cso: bad alignment (%u)", cso->header.align);
+      goto cso_failed;
+    }
 
     size = ((cso->header.total_bytes >> 11) + 1)*4 + sizeof(*cso);
     tmp = realloc(cso, size);
@@ -233,9 +481,17 @@ zip_failed:
     // all ok
     cso->fpos_in = ftell(f);
     cso->fpos_out = 0;
+    cso->buff_pos = cso->buff_len = 0;
     cso->block_in_buff = -1;
+    // NB stream must not move after init since zlib keeps a pointer to it
+    memset(&cso->stream, 0, sizeof(cso->stream));
+    if (inflateInit2(&cso->stream, -15) != Z_OK)
+      goto cso_failed;
     file = calloc(1, sizeof(*file));
-    if (file == NULL) goto cso_failed;
+    if (file == NULL) {
+      inflateEnd(&cso->stream);
+      goto cso_failed;
+    }
     file->file  = f;
     file->param = cso;
     file->size  = cso->header.total_bytes;
@@ -266,22 +522,21 @@ cso_failed:
     chd = calloc(1, sizeof(*chd));
     if (chd == NULL)
       goto chd_failed;
-    chd->hunk = (u8 *)malloc(head->hunkbytes);
-    if (!chd->hunk)
-      goto chd_failed;
 
-    chd->chd = cf;
     chd->unitbytes = head->unitbytes;
     chd->hunkunits = head->hunkbytes / head->unitbytes;
     chd->sectorsize = CD_MAX_SECTOR_DATA; // default to RAW mode
-
     chd->fpos = 0;
-    chd->hunknum = -1;
+    // subchannel data is skipped, remove it from total size
+    chd->file.size = head->logicalbytes / CD_FRAME_SIZE * CD_MAX_SECTOR_DATA;
+
+    // NB cf is owned by the image after this, and may have been closed
+    chd->img = chd_image_get(cf, path);
+    if (chd->img == NULL)
+      goto chd_failed;
 
     chd->file.file = chd;
     chd->file.type = PMT_CHD;
-    // subchannel data is skipped, remove it from total size
-    chd->file.size = head->logicalbytes / CD_FRAME_SIZE * CD_MAX_SECTOR_DATA;
     strncpy(chd->file.ext, ext, sizeof(chd->file.ext) - 1);
     return &chd->file;
 
@@ -310,6 +565,17 @@ chd_failed:
   strncpy(file->ext, ext, sizeof(file->ext) - 1);
   fseek(f, 0, SEEK_SET);
 
+#ifdef HAVE_MMAP
+  // f may be a VFS stream, so use a separate descriptor for mapping
+  if (file->size > 0) {
+    struct file_map *map = calloc(1, sizeof(*map));
+    if (map != NULL && (map->fd = open(path, O_RDONLY)) >= 0)
+      file->param = map;
+    else
+      free(map);
+  }
+#endif
+
 #ifdef __GP2X__
   if (file->size > 0x400000)
     /* we use our own buffering */
@@ -332,6 +598,36 @@ void pm_sectorsize(int length, pm_file *stream)
 #endif
 }
 
+// direct access to the file contents, avoiding seek and copy in the stdio layer.
+// returns NULL if the file can't be mapped, callers must fall back to pm_read.
+const void *pm_map(pm_file *stream, size_t offset, size_t length)
+{
+#ifdef HAVE_MMAP
+  struct file_map *map;
+
+  if (stream == NULL || stream->type != PMT_UNCOMPRESSED || stream->param == NULL)
+    return NULL;
+  if (offset + length > stream->size)
+    return NULL;
+
+  map = stream->param;
+  if (map->data == NULL) {
+    void *ptr = mmap(NULL, stream->size, PROT_READ, MAP_SHARED, map->fd, 0);
+    if (ptr == MAP_FAILED) {
+      elprintf(EL_STATUS, "mmap of %u bytes failed", stream->size);
+      close(map->fd);
+      free(map);
+      stream->param = NULL;
+      return NULL;
+    }
+    map->data = ptr;
+  }
+  return map->data + offset;
+#else
+  return NULL;
+#endif
+}
+
 #if defined(USE_LIBCHDR)
 static size_t _pm_read_chd(void *ptr, size_t bytes, pm_file *stream, int is_audio)
 {
@@ -347,15 +643,17 @@ static size_t _pm_read_chd(void *ptr, size_t bytes, pm_file *stream, int is_audi
     int hunknum = sector / chd->hunkunits;
     int hunksec = sector - (hunknum * chd->hunkunits);
     int hunkofs = hunksec * chd->unitbytes;
+    const u8 *hunk = NULL;
 
     while (bytes != 0) {
       // data left in current sector
       int len = sectsz - offset;
 
-      // update hunk cache if needed
-      if (hunknum != chd->hunknum) {
-        chd_read(chd->chd, hunknum, chd->hunk);
-        chd->hunknum = hunknum;
+      // fetch hunk from cache if needed
+      if (hunk == NULL) {
+        hunk = chd_get_hunk(chd->img, hunknum);
+        if (hunk == NULL)
+          break;
       }
       if (len > bytes)
         len = bytes;
@@ -364,7 +662,7 @@ static size_t _pm_read_chd(void *ptr, size_t bytes, pm_file *stream, int is_audi
       if (is_audio) {
         // convert big endian audio samples
         u16 *dst = ptr, v;
-        u8 *src = chd->hunk + hunkofs + offset;
+        const u8 *src = hunk + hunkofs + offset;
         int i;
 
         for (i = 0; i < len; i += 4) {
@@ -373,7 +671,7 @@ static size_t _pm_read_chd(void *ptr, size_t bytes, pm_file *stream, int is_audi
         }
       } else
 #endif
-        memcpy(ptr, chd->hunk + hunkofs + offset, len);
+        memcpy(ptr, hunk + hunkofs + offset, len);
 
       // house keeping
       ret += len;
@@ -392,6 +690,7 @@ static size_t _pm_read_chd(void *ptr, size_t bytes, pm_file *stream, int is_audi
           hunksec = 0;
           hunkofs = 0;
           hunknum ++;
+          hunk = NULL;
         }
       }
     }
@@ -425,6 +724,8 @@ size_t pm_read(void *ptr, size_t bytes, pm_file *stream)
     z->stream.avail_out = bytes;
     while (z->stream.avail_out != 0) {
       if (z->stream.avail_in == 0) {
+        if (z->map != NULL)
+          break;
         z->stream.avail_in = fread(z->inbuf, 1, sizeof(z->inbuf), z->zip->fp);
         if (z->stream.avail_in == 0)
           break;
@@ -444,63 +745,37 @@ size_t pm_read(void *ptr, size_t bytes, pm_file *stream)
   else if (stream->type == PMT_CSO)
   {
     cso_struct *cso = stream->param;
-    int read_pos, read_len, out_offs, rret;
+    int out_offs, rret;
     int block = cso->fpos_out >> 11;
-    int index = cso->index[block];
-    int index_end = cso->index[block+1];
-    unsigned char *out = ptr, *tmp_dst;
+    int blocks = (cso->header.total_bytes + 2047) >> 11;
+    unsigned char *out = ptr;
 
     ret = 0;
-    while (bytes != 0)
+    while (bytes != 0 && block < blocks)
     {
       out_offs = cso->fpos_out&0x7ff;
-      if (out_offs == 0 && bytes >= 2048)
-           tmp_dst = out;
-      else tmp_dst = cso->out_buff;
-
-      read_pos = (index&0x7fffffff) << cso->header.align;
-
-      if (index < 0) {
-        if (read_pos != cso->fpos_in)
-          fseek(stream->file, read_pos, SEEK_SET);
-        rret = fread(tmp_dst, 1, 2048, stream->file);
-        cso->fpos_in = read_pos + rret;
-        if (rret != 2048) break;
+      if (out_offs == 0 && bytes >= 2048) {
+        // full block, decompress directly to destination
+        if (cso_read_block(cso, stream->file, block, out) != 0)
+          break;
+        rret = 2048;
       } else {
-        read_len = (((index_end&0x7fffffff) << cso->header.align) - read_pos) & 0xfff;
-        if (block != cso->block_in_buff)
-        {
-          if (read_pos != cso->fpos_in)
-            fseek(stream->file, read_pos, SEEK_SET);
-          rret = fread(cso->in_buff, 1, read_len, stream->file);
-          cso->fpos_in = read_pos + rret;
-          if (rret != read_len) {
-            elprintf(EL_STATUS, "cso: read failed @ %08x", read_pos);
+        //elprintf(EL_STATUS, "cso: unaligned/nonfull @ %08x, offs=%i, len=%u", cso->fpos_out, out_offs, bytes);
+        if (block != cso->block_in_buff) {
+          cso->block_in_buff = -1;
+          if (cso_read_block(cso, stream->file, block, cso->out_buff) != 0)
             break;
-          }
           cso->block_in_buff = block;
         }
-        rret = uncompress_buf(tmp_dst, 2048, cso->in_buff, read_len);
-        if (rret != 0) {
-          elprintf(EL_STATUS, "cso: uncompress failed @ %08x with %i", read_pos, rret);
-          break;
-        }
-      }
-
-      rret = 2048;
-      if (out_offs != 0 || bytes < 2048) {
-        //elprintf(EL_STATUS, "cso: unaligned/nonfull @ %08x, offs=%i, len=%u", cso->fpos_out, out_offs, bytes);
+        rret = 2048 - out_offs;
         if (bytes < rret) rret = bytes;
-        if (2048 - out_offs < rret) rret = 2048 - out_offs;
-        memcpy(out, tmp_dst + out_offs, rret);
+        memcpy(out, cso->out_buff + out_offs, rret);
       }
       ret += rret;
       out += rret;
       cso->fpos_out += rret;
       bytes -= rret;
       block++;
-      index = index_end;
-      index_end = cso->index[block+1];
     }
   }
 #if defined(USE_LIBCHDR)
@@ -575,9 +850,7 @@ int pm_seek(pm_file *stream, long offset, int whence)
     offset = pos - z->pos;
     if (pos < z->pos) {
       // full decompress from the start
-      fseek(z->zip->fp, z->start, SEEK_SET);
-      z->stream.avail_in = 0;
-      z->stream.next_in = z->inbuf;
+      zip_rewind(z);
       inflateReset(&z->stream);
       z->pos = 0;
       offset = pos;
@@ -632,16 +905,31 @@ int pm_close(pm_file *fp)
 
   if (fp->type == PMT_UNCOMPRESSED)
   {
+#ifdef HAVE_MMAP
+    struct file_map *map = fp->param;
+    if (map != NULL) {
+      if (map->data != NULL)
+        munmap(map->data, fp->size);
+      close(map->fd);
+      free(map);
+    }
+#endif
     fclose(fp->file);
   }
   else if (fp->type == PMT_ZIP)
   {
     struct zip_file *z = fp->file;
     inflateEnd(&z->stream);
+#ifdef HAVE_MMAP
+    if (z->map != NULL)
+      munmap(z->map, z->start + z->entry->compressed_size);
+#endif
     closezip(z->zip);
   }
   else if (fp->type == PMT_CSO)
   {
+    cso_struct *cso = fp->param;
+    inflateEnd(&cso->stream);
     free(fp->param);
     fclose(fp->file);
   }
@@ -649,9 +937,7 @@ int pm_close(pm_file *fp)
   else if (fp->type == PMT_CHD)
   {
     struct chd_struct *chd = fp->file;
-    chd_close(chd->chd);
-    if (chd->hunk)
-      free(chd->hunk);
+    chd_image_put(chd->img);
   }
 #endif
   else
@@ -741,6 +1027,55 @@ void *PicoCartAlloc(int filesize, int is_sms)
   return rom;
 }
 
+#ifdef HAVE_MMAP
+// replace the start of the ROM buffer by a private mapping of the file. The
+// pages are shared with all other users of the file until they are written
+// to, e.g. by carthw patches or idle loop detection.
+static int PicoCartMap(pm_file *f, unsigned char *rom, int size, int is_sms)
+{
+  struct file_map *map = f->param;
+  size_t pgmask = sysconf(_SC_PAGESIZE) - 1;
+  size_t len = (f->size + pgmask) & ~pgmask;
+
+  // only usable if the ROM data needs no conversion after loading
+  if (CPU_IS_LE && !is_sms)
+    return 0;
+  if (size >= 0x4200 && (size&0x3fff) == 0x200) // SMD header
+    return 0;
+  if (map == NULL || ((uintptr_t)rom & pgmask) ||
+      len > ((rom_alloc_size + pgmask) & ~pgmask))
+    return 0;
+
+  if (mmap(rom, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, map->fd, 0)
+      == MAP_FAILED)
+    return 0;
+
+  elprintf(EL_STATUS, "ROM mapped from file");
+  rom_mapped = 1;
+  return 1;
+}
+
+// file mappings can't be resized, convert ROM to anonymous memory first
+static int PicoCartUnmap(void)
+{
+  void *tmp = malloc(rom_alloc_size);
+  if (tmp == NULL)
+    return -1;
+
+  memcpy(tmp, Pico.rom, rom_alloc_size);
+  if (mmap(Pico.rom, rom_alloc_size, PROT_READ|PROT_WRITE,
+      MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0) == MAP_FAILED) {
+    free(tmp);
+    return -1;
+  }
+  memcpy(Pico.rom, tmp, rom_alloc_size);
+  free(tmp);
+
+  rom_mapped = 0;
+  return 0;
+}
+#endif
+
 int PicoCartLoad(pm_file *f, const unsigned char *rom, unsigned int romsize,
   unsigned char **prom, unsigned int *psize, int is_sms)
 {
@@ -766,6 +1101,15 @@ int PicoCartLoad(pm_file *f, const unsigned char *rom, unsigned int romsize,
   }
 
   if (!rom) {
+#ifdef HAVE_MMAP
+    if (f->type == PMT_UNCOMPRESSED && PicoCartMap(f, rom_data, size, is_sms))
+    {
+      bytes_read = size;
+      if (PicoCartLoadProgressCB != NULL)
+        PicoCartLoadProgressCB(100);
+    }
+    else
+#endif
     if (PicoCartLoadProgressCB != NULL)
     {
       // read ROM in blocks, just for fun
@@ -790,6 +1134,7 @@ int PicoCartLoad(pm_file *f, const unsigned char *rom, unsigned int romsize,
       elprintf(EL_STATUS, "read failed");
       plat_munmap(rom_data, rom_alloc_size);
       rom_alloc_size = 0;
+      rom_mapped = 0;
       return 3;
     }
   }
@@ -889,7 +1234,13 @@ int PicoCartInsert(unsigned char *rom, unsigned int romsize, const char *carthw_
 
 int PicoCartResize(int newsize)
 {
-  void *tmp = plat_mremap(Pico.rom, rom_alloc_size, newsize);
+  void *tmp;
+
+#ifdef HAVE_MMAP
+  if (rom_mapped && PicoCartUnmap() != 0)
+    return -1;
+#endif
+  tmp = plat_mremap(Pico.rom, rom_alloc_size, newsize);
   if (tmp == NULL)
     return -1;
 
@@ -909,24 +1260,39 @@ void PicoCartUnload(void)
 
   if (Pico.rom != NULL) {
     SekFinishIdleDet();
+    SekIdleLoopsClear();
     plat_munmap(Pico.rom, rom_alloc_size);
     rom_alloc_size = 0;
+    rom_mapped = 0;
     Pico.rom = NULL;
     Pico.romsize = 0;
   }
   PicoGameLoaded = 0;
 }
 
-static unsigned int rom_crc32(int size)
+unsigned int rom_crc32(int size)
 {
-  unsigned int crc;
+  unsigned int crc = 0;
+#if CPU_IS_LE
+  unsigned int buf[0x400];
+  int i, n;
+#endif
   elprintf(EL_STATUS, "calculating CRC32..");
   if (size <= 0 || size > Pico.romsize) size = Pico.romsize;
 
-  // have to unbyteswap for calculation..
-  Byteswap(Pico.rom, Pico.rom, size);
+#if CPU_IS_LE
+  // have to unbyteswap for calculation. Do it in a local buffer, since
+  // the ROM may be a shared file mapping which must not be written to
+  for (i = 0; i < size; i += n) {
+    n = size - i < sizeof(buf) ? size - i : sizeof(buf);
+    Byteswap(buf, Pico.rom + i, n);
+    if (n & 3) // tail which Byteswap doesn't handle
+      memcpy((u8 *)buf + (n & ~3), Pico.rom + i + (n & ~3), n & 3);
+    crc = crc32(crc, (u8 *)buf, n);
+  }
+#else
   crc = crc32(0, Pico.rom, size);
-  Byteswap(Pico.rom, Pico.rom, size);
+#endif
   return crc;
 }
 
@@ -1219,6 +1585,8 @@ static void parse_carthw(const char *carthw_cfg, int *fill_sram,
         PicoIn.quirks |= PQUIRK_FORCE_6BTN;
       else if (strcmp(p, "no_z80_bus_lock") == 0)
         PicoIn.quirks |= PQUIRK_NO_Z80_BUS_LOCK;
+      else if (strcmp(p, "no_idle_det") == 0)
+        PicoIn.quirks |= PQUIRK_NO_IDLE_DET;
       else {
         elprintf(EL_STATUS, "carthw:%d: unsupported prop: %s", line, p);
         goto bad_nomsg;
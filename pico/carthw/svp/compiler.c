@@ -1855,7 +1855,7 @@ int ssp1601_dyn_startup(void)
 		return -1;
 	}
 
-	memset(tcache, 0, DRC_TCACHE_SIZE);
+	memset(TCACHE_RW(tcache), 0, DRC_TCACHE_SIZE);
 	tcache_ptr = (void *)tcache;
 
 	PicoLoadStateHook = ssp1601_state_load;
@@ -6,6 +6,8 @@
  * See COPYING file in the top-level directory.
  */
 
+#include <sys/stat.h>
+
 #include "../pico_int.h"
 #include "genplus_macros.h"
 #include "cdd.h"
@@ -15,6 +17,165 @@
 #pragma GCC diagnostic ignored "-Wformat-truncation"
 #endif
 
+// Index of audio track lengths, kept in a file in PicoCDIndexDir.
+// Determining mp3/ogg track lengths needs parsing the audio files, which
+// can take quite some time for larger images. Entries are checked against
+// the file size and modification time of the track file.
+#define TOC_INDEX_EXT ".idx"
+
+const char *PicoCDIndexDir; // with trailing separator, NULL for no index
+
+struct toc_index_entry {
+  char *fname;
+  long size, mtime;
+  int length;
+};
+
+static struct {
+  struct toc_index_entry *entries;
+  int count, alloc;
+  int dirty;
+} toc_index;
+
+static int toc_index_stat(const char *fname, long *size, long *mtime)
+{
+  struct stat st;
+  if (stat(fname, &st) != 0)
+    return -1;
+  *size = st.st_size;
+  *mtime = st.st_mtime;
+  return 0;
+}
+
+static void toc_index_add(const char *fname, long size, long mtime, int length)
+{
+  struct toc_index_entry *e;
+
+  if (toc_index.count >= toc_index.alloc) {
+    int alloc = toc_index.alloc ? toc_index.alloc * 2 : 16;
+    e = realloc(toc_index.entries, alloc * sizeof(*e));
+    if (e == NULL)
+      return;
+    toc_index.entries = e;
+    toc_index.alloc = alloc;
+  }
+  e = &toc_index.entries[toc_index.count];
+  e->fname = strdup(fname);
+  if (e->fname == NULL)
+    return;
+  e->size = size;
+  e->mtime = mtime;
+  e->length = length;
+  toc_index.count++;
+}
+
+static void toc_index_free(void)
+{
+  int i;
+  for (i = 0; i < toc_index.count; i++)
+    free(toc_index.entries[i].fname);
+  free(toc_index.entries);
+  memset(&toc_index, 0, sizeof(toc_index));
+}
+
+// <index dir><image file name>.idx
+static int toc_index_path(char *buf, int size, const char *img_name)
+{
+  const char *p;
+
+  if (PicoCDIndexDir == NULL || *PicoCDIndexDir == 0)
+    return -1;
+  for (p = img_name + strlen(img_name); p > img_name; p--)
+    if (p[-1] == '/' || p[-1] == '\\')
+      break;
+  snprintf(buf, size, "%s%s" TOC_INDEX_EXT, PicoCDIndexDir, p);
+  return 0;
+}
+
+static void toc_index_load(const char *img_name)
+{
+  char buf[512], *p;
+  long size, mtime;
+  int length;
+  FILE *f;
+
+  toc_index_free();
+  if (toc_index_path(buf, sizeof(buf), img_name) != 0)
+    return;
+  f = fopen(buf, "r");
+  if (f == NULL)
+    return;
+
+  // format: <size> <mtime> <length> <file name>
+  while (fgets(buf, sizeof(buf), f) != NULL) {
+    if (sscanf(buf, "%ld %ld %d", &size, &mtime, &length) != 3)
+      continue;
+    for (p = buf; *p != 0 && *p != '\t'; p++)
+      ;
+    if (*p++ == 0)
+      continue;
+    p[strcspn(p, "\r\n")] = 0;
+    toc_index_add(p, size, mtime, length);
+  }
+  fclose(f);
+}
+
+static void toc_index_save(const char *img_name)
+{
+  char buf[512];
+  FILE *f;
+  int i;
+
+  if (!toc_index.dirty || toc_index_path(buf, sizeof(buf), img_name) != 0)
+    return;
+  f = fopen(buf, "w");
+  if (f == NULL) {
+    elprintf(EL_STATUS, "can't write index %s", buf);
+    return;
+  }
+  for (i = 0; i < toc_index.count; i++) {
+    struct toc_index_entry *e = &toc_index.entries[i];
+    fprintf(f, "%ld %ld %d\t%s\n", e->size, e->mtime, e->length, e->fname);
+  }
+  fclose(f);
+}
+
+static int toc_index_lookup(const char *fname)
+{
+  long size, mtime;
+  int i;
+
+  if (toc_index_stat(fname, &size, &mtime) != 0)
+    return -1;
+  for (i = 0; i < toc_index.count; i++) {
+    struct toc_index_entry *e = &toc_index.entries[i];
+    if (strcmp(e->fname, fname) == 0)
+      return (e->size == size && e->mtime == mtime) ? e->length : -1;
+  }
+  return -1;
+}
+
+static void toc_index_store(const char *fname, int length)
+{
+  long size, mtime;
+  int i;
+
+  if (toc_index_stat(fname, &size, &mtime) != 0)
+    return;
+  for (i = 0; i < toc_index.count; i++) {
+    struct toc_index_entry *e = &toc_index.entries[i];
+    if (strcmp(e->fname, fname) == 0) {
+      e->size = size;
+      e->mtime = mtime;
+      e->length = length;
+      toc_index.dirty = 1;
+      return;
+    }
+  }
+  toc_index_add(fname, size, mtime, length);
+  toc_index.dirty = 1;
+}
+
 static int handle_mp3(const char *fname, int index)
 {
   track_t *track = &cdd.toc.tracks[index];
@@ -26,6 +187,10 @@ static int handle_mp3(const char *fname, int index)
   if (tmp_file == NULL)
     return -1;
 
+  fs = toc_index_lookup(fname);
+  if (fs > 0)
+    goto found;
+
   ret = fseek(tmp_file, 0, SEEK_END);
   fs = ftell(tmp_file);
   fseek(tmp_file, 0, SEEK_SET);
@@ -38,6 +203,11 @@ static int handle_mp3(const char *fname, int index)
     return -1;
   }
 
+  fs *= 75;
+  fs /= kBps * 1000;
+  toc_index_store(fname, fs);
+
+found:
 #ifdef _PSP_FW_VERSION
   // some systems (like PSP) can't have many open files at a time,
   // so we work with their names instead.
@@ -49,8 +219,6 @@ static int handle_mp3(const char *fname, int index)
   track->fd = tmp_file;
   track->offset = 0;
 
-  fs *= 75;
-  fs /= kBps * 1000;
   return fs;
 }
 
@@ -64,15 +232,21 @@ static int handle_ogg(const char *fname, int index)
   if (tmp_file == NULL)
     return -1;
 
-  fs = ogg_get_length(tmp_file);
+  fs = toc_index_lookup(fname);
+  if (fs > 0)
+    goto found;
 
+  fs = ogg_get_length(tmp_file);
   if (fs <= 0)
   {
     elprintf(EL_STATUS, "track %2i: ogg length %i", index+1, fs);
     fclose(tmp_file);
     return -1;
   }
+  fs = fs * 75 / 1000;
+  toc_index_store(fname, fs);
 
+found:
 #ifdef _PSP_FW_VERSION
   // some systems (like PSP) can't have many open files at a time,
   // so we work with their names instead.
@@ -84,7 +258,7 @@ static int handle_ogg(const char *fname, int index)
   track->fd = tmp_file;
   track->offset = 0;
 
-  return fs * 75 / 1000;
+  return fs;
 }
 
 static void to_upper(char *d, const char *s)
@@ -117,11 +291,15 @@ int load_cd_image(const char *cd_img_name, int *type)
   char tmp_name[256], tmp_ext[10], tmp_ext_u[10];
   track_t *tracks = cdd.toc.tracks;
   cd_data_t *cue_data = NULL;
+  char *index_name;
   pm_file *pmf;
 
   if (PicoCDLoadProgressCB != NULL)
     PicoCDLoadProgressCB(cd_img_name, 1);
 
+  toc_index_load(cd_img_name);
+  index_name = strdup(cd_img_name);
+
   /* is this a .cue? */
   cue_data = cue_parse(cd_img_name);
   if (cue_data != NULL) {
@@ -138,6 +316,8 @@ int load_cd_image(const char *cd_img_name, int *type)
   {
     if (cue_data != NULL)
       cdparse_destroy(cue_data);
+    toc_index_free();
+    free(index_name);
     return -1;
   }
   tracks[0].fd = pmf;
@@ -323,6 +503,11 @@ finish:
   if (cue_data != NULL)
     cdparse_destroy(cue_data);
 
+  if (index_name != NULL)
+    toc_index_save(index_name);
+  toc_index_free();
+  free(index_name);
+
   return 0;
 }
 
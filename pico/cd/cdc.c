@@ -292,6 +292,9 @@ static void do_dma(enum dma_type type, int bytes_in)
         memcpy(dst, cdc.ram + src_addr, bytes);
         break;
       }
+      if (vgm_logging)
+        vgm_log_pcm_ram(dst_addr, Pico_mcd->pcm_ram_b[Pico_mcd->pcm.bank] + dst_addr,
+          bytes_in < 0x1000 - dst_addr ? bytes_in : 0x1000 - dst_addr);
       goto update_dma;
 
     case prg_ram_dma_w:
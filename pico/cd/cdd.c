@@ -154,6 +154,7 @@ static void ogg_free(int i)
 #endif
 
 static off_t read_pos = -1;
+static int read_mapped; // file position doesn't match read_pos
 
 void cdd_reset(void)
 {
@@ -185,6 +186,7 @@ void cdd_reset(void)
   Pico_mcd->s68k_regs[0x36+0] = 0x01;
   /* reset file read position */
   read_pos = -1;
+  read_mapped = 0;
 }
 
 /* FIXME: use cdd_read_audio() instead */
@@ -247,6 +249,7 @@ static void cdd_seek(int index, int lba)
     /* DATA track */
     read_pos = lba * cdd.sectorSize;
     pm_seek(cdd.toc.tracks[cdd.index].fd, read_pos, SEEK_SET);
+    read_mapped = 0;
   }
 #ifdef USE_LIBTREMOR
   else if (cdd.toc.tracks[cdd.index].vf.seekable)
@@ -539,6 +542,7 @@ void cdd_read_data(uint8 *dst)
   if (!is_audio(cdd.index) && (cdd.lba >= cdd.toc.tracks[cdd.index].start) &&
                               (cdd.lba < cdd.toc.tracks[cdd.index].end))
   {
+    const void *src;
     off_t pos;
 
     /* BIN format ? */
@@ -552,9 +556,20 @@ void cdd_read_data(uint8 *dst)
       pos = cdd.lba * cdd.sectorSize;
     }
 
-    if (pos != read_pos) {
+    /* mapped image files are accessed directly */
+    src = pm_map(cdd.toc.tracks[cdd.index].fd, pos, 2048);
+    if (src != NULL)
+    {
+      memcpy(dst, src, 2048);
+      read_pos = pos + 2048;
+      read_mapped = 1;
+      return;
+    }
+
+    if (pos != read_pos || read_mapped) {
       pm_seek(cdd.toc.tracks[cdd.index].fd, pos, SEEK_SET);
       read_pos = pos;
+      read_mapped = 0;
     }
 
     /* read sector data (Mode 1 = 2048 bytes) */
@@ -178,17 +178,22 @@ int gfx_context_load(const uint8 *state)
   return bufferptr;
 }
 
-static inline int gfx_pixel(uint32 xpos, uint32 ypos, uint16 *lut_cell)
+/* NB stamp map parameters are passed in from locals, since the compiler
+ * can't know gfx isn't modified by the byte writes to word RAM and would
+ * reload them for every pixel otherwise */
+static inline int gfx_pixel(uint32 xpos, uint32 ypos, uint16 *lut_cell,
+  const uint16 *mapPtr, const uint8 *lut_pixel, const uint8 *wram,
+  uint32 dotMask, uint32 stampMask, int stampShift, int mapShift)
 {
   uint16 stamp_data;
   uint32 stamp_index;
   uint8 pixel_out = 0x00;
 
   /* check if pixel is outside stamp map */
-  if (((xpos | ypos) & ~gfx.dotMask) == 0)
+  if (((xpos | ypos) & ~dotMask) == 0)
   {
     /* read stamp map table data */
-    stamp_data = gfx.mapPtr[(xpos >> gfx.stampShift) | ((ypos >> gfx.stampShift) << gfx.mapShift)];
+    stamp_data = mapPtr[(xpos >> stampShift) | ((ypos >> stampShift) << mapShift)];
 
     /* stamp generator base index                                     */
     /* sss ssssssss ccyyyxxx (16x16) or sss sssssscc ccyyyxxx (32x32) */
@@ -196,7 +201,7 @@ static inline int gfx_pixel(uint32 xpos, uint32 ypos, uint16 *lut_cell)
     /*        c = cell offset  (0-3 for 16x16, 0-15 for 32x32)        */
     /*      yyy = line offset  (0-7)                                  */
     /*      xxx = pixel offset (0-7)                                  */
-    stamp_index = (stamp_data & gfx.stampMask) << 8;
+    stamp_index = (stamp_data & stampMask) << 8;
 
     if (stamp_index)
     {
@@ -215,10 +220,10 @@ static inline int gfx_pixel(uint32 xpos, uint32 ypos, uint16 *lut_cell)
       /* with: yyy = pixel row  (0-7) = (ypos >> 11) & 7   */
       /*       xxx = pixel column (0-7) = (xpos >> 11) & 7 */
       /*       hrr = HFLIP & ROTATION bits                 */
-      stamp_index |= gfx.lut_pixel[stamp_data | ((ypos >> 5) & 0x1c0) | ((xpos >> 8) & 0x38)];
+      stamp_index |= lut_pixel[stamp_data | ((ypos >> 5) & 0x1c0) | ((xpos >> 8) & 0x38)];
 
       /* read pixel pair (2 pixels/byte) */
-      pixel_out = READ_BYTE(Pico_mcd->word_ram2M, stamp_index >> 1);
+      pixel_out = READ_BYTE(wram, stamp_index >> 1);
 
       /* extract left or right pixel */
       pixel_out >>= 4 * !(stamp_index & 1);
@@ -242,20 +247,21 @@ static inline int gfx_pixel(uint32 xpos, uint32 ypos, uint16 *lut_cell)
     ypos &= mask;							\
 									\
     if (COND1) {							\
-      pixel_out = gfx_pixel(xpos, ypos, lut_cell);			\
+      pixel_out = gfx_pixel(xpos, ypos, lut_cell, mapPtr, lut_pixel,	\
+                    wram, dotMask, stampMask, stampShift, mapShift);	\
       UPDP;								\
     }									\
 									\
     if (COND2) {							\
       /* read out paired pixel data */					\
-      pixel_in = READ_BYTE(Pico_mcd->word_ram2M, bufferIndex >> 1);	\
+      pixel_in = READ_BYTE(wram, bufferIndex >> 1);			\
 									\
       /* priority mode write */						\
       pixel_in = (lut_prio[(pixel_in & 0xf0) >> 4][pixel_out] << 4) |	\
                  (pixel_in & 0x0f);					\
 									\
       /* write data to image buffer */					\
-      WRITE_BYTE(Pico_mcd->word_ram2M, bufferIndex >> 1, pixel_in);	\
+      WRITE_BYTE(wram, bufferIndex >> 1, pixel_in);			\
     }									\
 									\
     /* increment pixel position */					\
@@ -270,20 +276,21 @@ right##N:								\
     ypos &= mask;							\
 									\
     if (COND1) {							\
-      pixel_out = gfx_pixel(xpos, ypos, lut_cell);			\
+      pixel_out = gfx_pixel(xpos, ypos, lut_cell, mapPtr, lut_pixel,	\
+                    wram, dotMask, stampMask, stampShift, mapShift);	\
       UPDP;								\
     }									\
 									\
     if (COND2) {							\
       /* read out paired pixel data */					\
-      pixel_in = READ_BYTE(Pico_mcd->word_ram2M, bufferIndex >> 1);	\
+      pixel_in = READ_BYTE(wram, bufferIndex >> 1);			\
 									\
       /* priority mode write */						\
       pixel_in = (lut_prio[pixel_in & 0x0f][pixel_out]) |		\
                  (pixel_in & 0xf0);					\
 									\
       /* write data to image buffer */					\
-      WRITE_BYTE(Pico_mcd->word_ram2M, bufferIndex >> 1, pixel_in);	\
+      WRITE_BYTE(wram, bufferIndex >> 1, pixel_in);			\
     }									\
 									\
     /* increment pixel position */					\
@@ -296,7 +303,7 @@ right##N:								\
     if ((bufferIndex & 7) == 0)						\
     {									\
       /* next cell: increment buffer offset by one column (minus 8 pixels) */ \
-      bufferIndex += gfx.bufferOffset-1;				\
+      bufferIndex += bufferOffset-1;					\
     }									\
   }									\
 } while (0)
@@ -308,6 +315,12 @@ static void gfx_render(uint32 bufferIndex, uint32 width)
   uint8 (*lut_prio)[0x10];
   uint16 *lut_cell;
   uint32 mask;
+  uint8 *wram = Pico_mcd->word_ram2M;
+  const uint16 *mapPtr = gfx.mapPtr;
+  const uint8 *lut_pixel = gfx.lut_pixel;
+  uint32 dotMask = gfx.dotMask, stampMask = gfx.stampMask;
+  int stampShift = gfx.stampShift, mapShift = gfx.mapShift;
+  uint32 bufferOffset = gfx.bufferOffset;
 
   /* pixel map start position for current line (13.3 format converted to 13.11) */
   uint32 xpos = *gfx.tracePtr++ << 8;
@@ -328,7 +341,7 @@ static void gfx_render(uint32 bufferIndex, uint32 width)
   if (Pico_mcd->s68k_regs[0x58+1] & 0x01)
   {
     /* stamp map range */
-    mask = gfx.dotMask;
+    mask = dotMask;
   }
 
   pixel_out = 0;
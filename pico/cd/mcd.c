@@ -38,9 +38,12 @@ PICO_INTERNAL void PicoCreateMCD(unsigned char *bios_data, int bios_size)
   }
 }
 
+static struct pico_events pcd_events;
+
 PICO_INTERNAL void PicoInitMCD(void)
 {
   SekInitS68k();
+  pevents_register(&pcd_events);
 }
 
 PICO_INTERNAL void PicoExitMCD(void)
@@ -133,6 +136,7 @@ static void SekRunS68k(unsigned int to)
     return;
 
   pprof_start(s68k);
+  pstats_start();
   SekCycleCntS68k += cyc_do;
 #if defined(EMU_C68K)
   PicoCpuCS68k.cycles = cyc_do;
@@ -146,6 +150,8 @@ static void SekRunS68k(unsigned int to)
   SekCycleCntS68k += fm68k_emulate(&PicoCpuFS68k, cyc_do, 0) - cyc_do;
 #endif
   SekCyclesLeftS68k = 0;
+  pstats_end(PSTATS_S68K);
+  pstats_add(PSTATS_S68K, run, SekCycleCntS68k - (to - cyc_do));
   pprof_end(s68k);
 }
 
@@ -163,6 +169,12 @@ unsigned int pcd_cycles_m68k_to_s68k(unsigned int c)
   return (long long)c * mcd_m68k_cycle_mult >> 16;
 }
 
+// current s68k position in main 68k cycles since frame start
+int pcd_s68k_frame_cycles(void)
+{
+  return 1LL*(SekCyclesDoneS68k() - mcd_s68k_cycle_base) * mcd_s68k_cycle_mult >> 16;
+}
+
 /* events */
 static void pcd_cdc_event(unsigned int now)
 {
@@ -221,36 +233,29 @@ static void pcd_dma_event(unsigned int now)
   cdc_dma_update();
 }
 
-typedef void (event_cb)(unsigned int now);
-
 /* times are in s68k (12.5MHz) cycles */
 unsigned int pcd_event_times[PCD_EVENT_COUNT];
-static unsigned int event_time_next;
-static event_cb *pcd_event_cbs[PCD_EVENT_COUNT] = {
+static event_cb * const pcd_event_cbs[PCD_EVENT_COUNT] = {
   pcd_cdc_event,            // PCD_EVENT_CDC
   pcd_int3_timer_event,     // PCD_EVENT_TIMER3
   gfx_update,               // PCD_EVENT_GFX
   pcd_dma_event,            // PCD_EVENT_DMA
 };
-
-void pcd_event_schedule(unsigned int now, enum pcd_event event, int after)
+static unsigned int pcd_event_to_m68k(unsigned int t)
 {
-  unsigned int when;
-
-  if ((now|after) == 0) {
-    // event cancelled
-    pcd_event_times[event] = 0;
-    return;
-  }
-
-  when = now + after;
-  when |= 1;
+  return mcd_m68k_cycle_base +
+    (1LL*(int)(t - mcd_s68k_cycle_base) * mcd_s68k_cycle_mult >> 16);
+}
 
-  elprintf(EL_CD, "cd: new event #%u %u->%u", event, now, when);
-  pcd_event_times[event] = when;
+static struct pico_events pcd_events = {
+  pcd_event_times, pcd_event_cbs, PCD_EVENT_COUNT, 0, EL_CD, "cd",
+  PAHW_MCD, pcd_event_to_m68k
+};
+#define event_time_next pcd_events.next
 
-  if (event_time_next == 0 || CYCLES_GT(event_time_next, when))
-    event_time_next = when;
+void pcd_event_schedule(unsigned int now, enum pcd_event event, int after)
+{
+  pevents_schedule(&pcd_events, now, event, after);
 }
 
 void pcd_event_schedule_s68k(enum pcd_event event, int after)
@@ -262,41 +267,7 @@ void pcd_event_schedule_s68k(enum pcd_event event, int after)
 
 static void pcd_run_events(unsigned int until)
 {
-  int oldest, oldest_diff, time;
-  int i, diff;
-
-  while (1) {
-    oldest = -1, oldest_diff = 0x7fffffff;
-
-    for (i = 0; i < PCD_EVENT_COUNT; i++) {
-      if (pcd_event_times[i]) {
-        diff = pcd_event_times[i] - until;
-        if (diff < oldest_diff) {
-          oldest_diff = diff;
-          oldest = i;
-        }
-      }
-    }
-
-    if (oldest_diff <= 0) {
-      time = pcd_event_times[oldest];
-      pcd_event_times[oldest] = 0;
-      elprintf(EL_CD, "cd: run event #%d %u", oldest, time);
-      pcd_event_cbs[oldest](time);
-    }
-    else if (oldest_diff < 0x7fffffff) {
-      event_time_next = pcd_event_times[oldest];
-      break;
-    }
-    else {
-      event_time_next = 0;
-      break;
-    }
-  }
-
-  if (oldest != -1)
-    elprintf(EL_CD, "cd: next event #%d at %u",
-      oldest, event_time_next);
+  pevents_run(&pcd_events, until);
 }
 
 void pcd_irq_s68k(int irq, int state)
@@ -323,6 +294,8 @@ int pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
     m68k_target, now, s68k_target);
 
   if (Pico_mcd->m.busreq != 1) { /* busreq/reset */
+    if (CYCLES_GT(s68k_target, now))
+      pstats_add(PSTATS_S68K, idle, s68k_target - now);
     SekCycleCntS68k = SekCycleAimS68k = s68k_target;
     pcd_run_events(s68k_target);
     return 0;
@@ -336,9 +309,10 @@ int pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync)
     if (event_time_next && CYCLES_GT(target, event_time_next))
       target = event_time_next;
 
-    if (Pico_mcd->m.state_flags & (PCD_ST_S68K_POLL|PCD_ST_S68K_SLEEP))
+    if (Pico_mcd->m.state_flags & (PCD_ST_S68K_POLL|PCD_ST_S68K_SLEEP)) {
+      pstats_add(PSTATS_S68K, idle, target - now);
       SekCycleCntS68k = SekCycleAimS68k = target;
-    else
+    } else
       SekRunS68k(target);
 
     if (m68k_poll_sync && Pico_mcd->m.m68k_poll_cnt == 0)
@@ -439,11 +413,11 @@ PICO_INTERNAL void PicoFrameMCD(void)
   PicoFrameHints();
 }
 
-void pcd_state_loaded(void)
+void pcd_state_loaded(int flags)
 {
   unsigned int cycles;
 
-  pcd_state_loaded_mem();
+  pcd_state_loaded_mem(flags);
 
   memset(Pico_mcd->pcm_mixbuf, 0, sizeof(Pico_mcd->pcm_mixbuf));
   Pico_mcd->pcm_mixbuf_dirty = 0;
@@ -472,8 +446,7 @@ void pcd_state_loaded(void)
   }
 
   // reschedule
-  event_time_next = 0;
-  pcd_run_events(SekCycleCntS68k);
+  pevents_reset(&pcd_events, SekCycleCntS68k);
 
   // msd
   msd_load();
@@ -1057,8 +1057,11 @@ static void PicoWriteS68k8_pr(u32 a, u32 d)
   // PCM
   if ((a & 0x8000) == 0x0000) {
     a &= 0x7fff;
-    if (a >= 0x2000)
+    if (a >= 0x2000) {
       Pico_mcd->pcm_ram_b[Pico_mcd->pcm.bank][(a>>1)&0xfff] = d;
+      if (vgm_logging)
+        vgm_log_pcm_ram((a>>1)&0xfff, &Pico_mcd->pcm_ram_b[Pico_mcd->pcm.bank][(a>>1)&0xfff], 1);
+    }
     else if (a < 0x12)
       pcd_pcm_write(a>>1, d);
     return;
@@ -1080,8 +1083,11 @@ static void PicoWriteS68k16_pr(u32 a, u32 d)
   // PCM
   if ((a & 0x8000) == 0x0000) {
     a &= 0x7fff;
-    if (a >= 0x2000)
+    if (a >= 0x2000) {
       Pico_mcd->pcm_ram_b[Pico_mcd->pcm.bank][(a>>1)&0xfff] = d;
+      if (vgm_logging)
+        vgm_log_pcm_ram((a>>1)&0xfff, &Pico_mcd->pcm_ram_b[Pico_mcd->pcm.bank][(a>>1)&0xfff], 1);
+    }
     else if (a < 0x12)
       pcd_pcm_write(a>>1, d & 0xff);
     return;
@@ -1195,15 +1201,17 @@ static void remap_word_ram(u32 r3)
   }
 }
 
-void pcd_state_loaded_mem(void)
+void pcd_state_loaded_mem(int flags)
 {
   u32 r3 = Pico_mcd->s68k_regs[3];
 
   /* after load events */
-  if (r3 & 4) // 1M mode?
+  if ((r3 & 4) && !(flags & PSL_FAST)) // 1M mode, saved in 2M format?
     wram_2M_to_1M(Pico_mcd->word_ram2M);
-  remap_word_ram(r3);
-  remap_prg_window(Pico_mcd->m.busreq, r3);
+  if (!(flags & PSL_MAPS_OK)) {
+    remap_word_ram(r3);
+    remap_prg_window(Pico_mcd->m.busreq, r3);
+  }
   Pico_mcd->m.dmna_ret_2m &= 3;
 
   // restore hint vector
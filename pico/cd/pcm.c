@@ -15,6 +15,8 @@ void pcd_pcm_write(unsigned int a, unsigned int d)
   unsigned int cycles = SekCyclesDoneS68k();
   if ((int)(cycles - Pico_mcd->pcm.update_cycles) >= 384)
     pcd_pcm_sync(cycles);
+  if (vgm_logging)
+    vgm_log_pcm(a, d);
 
   if (a < 7)
   {
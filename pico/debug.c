@@ -10,6 +10,7 @@
 #include "sound/ym2612.h"
 #include "memory.h"
 #include "debug.h"
+#include <zlib.h>
 
 #define bit(r, x) ((r>>x)&1)
 #define MVP dstrp+=strlen(dstrp)
@@ -410,6 +411,50 @@ void PDebugZ80Frame(void)
   Pico.t.m68c_aim = Pico.t.m68c_cnt;
 }
 
+void PDebugStateHash(unsigned int *hash)
+{
+  unsigned char buff[0x60];
+
+  memset(hash, 0, PDH_COUNT * sizeof(*hash));
+
+  hash[PDH_RAM] = crc32(0, PicoMem.zram, sizeof(PicoMem.zram));
+  hash[PDH_CRAM] = crc32(0, (void *)PicoMem.cram, sizeof(PicoMem.cram));
+  hash[PDH_VRAM] = crc32(0, (void *)PicoMem.vram, sizeof(PicoMem.vram));
+  z80_pack(buff);
+  hash[PDH_CPU] = crc32(0, buff, Z80_STATE_SIZE);
+  if (PicoIn.AHW & PAHW_SMS)
+    return;
+
+  hash[PDH_RAM] = crc32(hash[PDH_RAM], PicoMem.ram, sizeof(PicoMem.ram));
+  hash[PDH_CRAM] = crc32(hash[PDH_CRAM], (void *)PicoMem.vsram, sizeof(PicoMem.vsram));
+  memset(buff, 0, sizeof(buff));
+  SekPackCpu(buff, 0);
+  hash[PDH_CPU] = crc32(hash[PDH_CPU], buff, sizeof(buff));
+
+  if (PicoIn.AHW & PAHW_MCD) {
+    hash[PDH_RAM] = crc32(hash[PDH_RAM], Pico_mcd->prg_ram, sizeof(Pico_mcd->prg_ram));
+    hash[PDH_RAM] = crc32(hash[PDH_RAM], Pico_mcd->word_ram2M, sizeof(Pico_mcd->word_ram2M));
+    memset(buff, 0, sizeof(buff));
+    SekPackCpu(buff, 1);
+    hash[PDH_CPU] = crc32(hash[PDH_CPU], buff, sizeof(buff));
+  }
+
+#ifndef NO_32X
+  if (PicoIn.AHW & PAHW_32X) {
+    unsigned char sh2buff[SH2_STATE_SIZE];
+    hash[PDH_RAM] = crc32(hash[PDH_RAM], (void *)Pico32xMem->sdram, sizeof(Pico32xMem->sdram));
+    hash[PDH_RAM] = crc32(hash[PDH_RAM], (void *)Pico32xMem->dram, sizeof(Pico32xMem->dram));
+    hash[PDH_CRAM] = crc32(hash[PDH_CRAM], (void *)Pico32xMem->pal, sizeof(Pico32xMem->pal));
+    memset(sh2buff, 0, sizeof(sh2buff));
+    sh2_pack(&msh2, sh2buff);
+    hash[PDH_CPU] = crc32(hash[PDH_CPU], sh2buff, sizeof(sh2buff));
+    memset(sh2buff, 0, sizeof(sh2buff));
+    sh2_pack(&ssh2, sh2buff);
+    hash[PDH_CPU] = crc32(hash[PDH_CPU], sh2buff, sizeof(sh2buff));
+  }
+#endif
+}
+
 void PDebugCPUStep(void)
 {
   if (PicoIn.AHW & PAHW_SMS)
@@ -418,28 +463,49 @@ void PDebugCPUStep(void)
     SekStepM68k();
 }
 
-#ifdef EVT_LOG
+// events are kept in a ring, only the last EVT_LOG_SIZE events are dumped
+#ifndef EVT_LOG_SIZE
+#define EVT_LOG_SIZE (4*1024*1024)
+#endif
+
 static struct evt_t {
   unsigned int cycles;
   short cpu;
   short evt;
 } *evts;
-static int first_frame;
-static int evt_alloc;
+static int last_frame;
 static int evt_cnt;
+static int evt_wrapped;
+int pevt_enabled;
 
-void pevt_log(unsigned int cycles, enum evt_cpu c, enum evt e)
+// PICO_EVT_TRACE=<file> writes a trace file on exit, PICO_EVT_LOG prints a
+// text log. Builds with EVT_LOG defined always print the log
+void pevt_init(void)
 {
-  if (first_frame == 0)
-    first_frame = Pico.m.frame_count;
-  if (evt_alloc == evt_cnt) {
-    evt_alloc = evt_alloc * 2 + 16 * 1024;
-    evts = realloc(evts, evt_alloc * sizeof(evts[0]));
+#ifdef EVT_LOG
+  pevt_enabled = 1;
+#else
+  pevt_enabled = getenv("PICO_EVT_TRACE") != NULL ||
+                 getenv("PICO_EVT_LOG") != NULL;
+#endif
+  if (pevt_enabled && evts == NULL) {
+    evts = malloc(EVT_LOG_SIZE * sizeof(evts[0]));
+    if (evts == NULL)
+      pevt_enabled = 0;
   }
+}
+
+void pevt_log(unsigned int cycles, enum evt_cpu c, enum evt e)
+{
+  if (evts == NULL)
+    return;
+  if (e == EVT_FRAME_START)
+    last_frame = Pico.m.frame_count;
   evts[evt_cnt].cycles = cycles;
   evts[evt_cnt].cpu = c;
   evts[evt_cnt].evt = e;
-  evt_cnt++;
+  if (++evt_cnt == EVT_LOG_SIZE)
+    evt_cnt = 0, evt_wrapped = 1;
 }
 
 static int evt_cmp(const void *p1, const void *p2)
@@ -459,6 +525,80 @@ static int evt_cmp(const void *p1, const void *p2)
   return 0;
 }
 
+// after the ring has wrapped it starts in the middle of run and poll phases.
+// Drop end records for which the start record has been overwritten
+static int evt_drop_unmatched(int count)
+{
+  char started[EVT_CPU_CNT][2] = {{0,}};
+  int i, n, poll;
+
+  for (i = n = 0; i < count; i++) {
+    int c = evts[i].cpu, e = evts[i].evt;
+    poll = (e == EVT_POLL_START || e == EVT_POLL_END);
+    if (e == EVT_RUN_START || e == EVT_POLL_START)
+      started[c][poll] = 1;
+    else if ((e == EVT_RUN_END || e == EVT_POLL_END) && !started[c][poll])
+      continue;
+    evts[n++] = evts[i];
+  }
+  return n;
+}
+
+// Chrome trace event format, can be loaded in chrome://tracing or Perfetto.
+// Run and poll phases are shown as spans per CPU, frames and scanlines as
+// instant events on the 68k.
+static void pevt_dump_trace(const char *fname, int count, int frame)
+{
+  static const char *cpu_names[EVT_CPU_CNT] = { "m68k", "s68k", "msh2", "ssh2" };
+  static const char *span_names[EVT_CNT] = { "", "", "run", "run", "poll", "poll" };
+  unsigned long long t = 0;
+  unsigned int cycles = evts[0].cycles;
+  int line = 0;
+  FILE *f;
+  int i;
+
+  f = fopen(fname, "w");
+  if (f == NULL) {
+    elprintf(EL_STATUS, "can't open %s", fname);
+    return;
+  }
+
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (i = 0; i < EVT_CPU_CNT; i++)
+    fprintf(f, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+      "\"args\":{\"name\":\"%s\"}},\n", i, cpu_names[i]);
+
+  for (i = 0; i < count; i++) {
+    int c = evts[i].cpu, e = evts[i].evt;
+    // 64 bit timestamps in 68k cycles, converted to us
+    t += (int)(evts[i].cycles - cycles);
+    cycles = evts[i].cycles;
+    fprintf(f, "%s{\"pid\":1,\"tid\":%d,\"ts\":%.3f,", i ? ",\n" : "",
+      c, t * 7000000.0 / (Pico.m.pal ? OSC_PAL : OSC_NTSC));
+
+    switch (e) {
+    case EVT_FRAME_START:
+      frame++;
+      line = 0;
+      fprintf(f, "\"ph\":\"i\",\"s\":\"p\",\"name\":\"frame %d\"}", frame);
+      break;
+    case EVT_NEXT_LINE:
+      line++;
+      fprintf(f, "\"ph\":\"i\",\"s\":\"t\",\"name\":\"line %d\"}", line);
+      break;
+    case EVT_RUN_START:
+    case EVT_POLL_START:
+      fprintf(f, "\"ph\":\"B\",\"name\":\"%s\"}", span_names[e]);
+      break;
+    default:
+      fprintf(f, "\"ph\":\"E\",\"name\":\"%s\"}", span_names[e]);
+      break;
+    }
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+}
+
 void pevt_dump(void)
 {
   static const char *evt_names[EVT_CNT] = {
@@ -470,15 +610,32 @@ void pevt_dump(void)
   unsigned int frame_cycles[EVT_CPU_CNT] = {0,};
   unsigned int frame_resched[EVT_CPU_CNT] = {0,};
   unsigned int cycles = 0;
-  int frame = first_frame - 1;
+  const char *trace = getenv("PICO_EVT_TRACE");
+  int count = evt_wrapped ? EVT_LOG_SIZE : evt_cnt;
+  int frame = last_frame;
   int line = 0;
   int cpu_mask = 0;
   int dirty = 0;
   int i;
 
-  qsort(evts, evt_cnt, sizeof(evts[0]), evt_cmp);
+  if (evts == NULL)
+    return;
+
+  qsort(evts, count, sizeof(evts[0]), evt_cmp);
+  if (evt_wrapped)
+    count = evt_drop_unmatched(count);
+
+  // frame numbering relative to the last frame logged
+  for (i = 0; i < count; i++)
+    if (evts[i].evt == EVT_FRAME_START)
+      frame--;
 
-  for (i = 0; i < evt_cnt; i++) {
+  if (trace != NULL) {
+    pevt_dump_trace(trace, count, frame);
+    goto out;
+  }
+
+  for (i = 0; i < count; i++) {
     int c = evts[i].cpu, e = evts[i].evt;
     int ei, ci;
 
@@ -548,8 +705,13 @@ void pevt_dump(void)
       break;
     }
   }
+
+out:
+  free(evts);
+  evts = NULL;
+  evt_cnt = evt_wrapped = 0;
+  pevt_enabled = 0;
 }
-#endif
 
 #if defined(CPU_CMP_R) || defined(CPU_CMP_W) || defined(DRC_CMP)
 static FILE *tl_f;
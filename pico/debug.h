@@ -9,6 +9,16 @@ void PDebugDumpMem(void);
 void PDebugZ80Frame(void);
 void PDebugCPUStep(void);
 
+// state hashes, for checking if emulation is identical between runs
+enum {
+  PDH_RAM,    // work RAM, incl. add-on RAM
+  PDH_VRAM,
+  PDH_CRAM,   // CRAM and VSRAM
+  PDH_CPU,    // CPU registers
+  PDH_COUNT
+};
+void PDebugStateHash(unsigned int *hash);
+
 #if defined(CPU_CMP_R) || defined(CPU_CMP_W) || defined(DRC_CMP)
 enum ctl_byte {
   CTL_68K_SLAVE = 0x02,
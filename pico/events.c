@@ -0,0 +1,109 @@
+/*
+ * timed event scheduler, shared by the add-on hardware
+ * (C) notaz, 2013
+ * (C) irixxxx, 2023
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+
+#include "pico_int.h"
+
+// queues of all units, for the next event of any of them in m68k time
+static struct pico_events *pevents_units[4];
+static int pevents_unit_count;
+
+void pevents_schedule(struct pico_events *ev, unsigned int now, int event, int after)
+{
+  unsigned int when;
+
+  if ((now|after) == 0) {
+    // event cancelled
+    ev->times[event] = 0;
+    return;
+  }
+
+  when = (now + after) | 1;
+
+  elprintf(ev->log_mask, "%s: new event #%u %u->%u", ev->name, event, now, when);
+  ev->times[event] = when;
+
+  if (ev->next == 0 || CYCLES_GT(ev->next, when))
+    ev->next = when;
+}
+
+void pevents_run(struct pico_events *ev, unsigned int until)
+{
+  int oldest, oldest_diff, time;
+  int i, diff;
+
+  while (1) {
+    oldest = -1, oldest_diff = 0x7fffffff;
+
+    for (i = 0; i < ev->count; i++) {
+      if (ev->times[i]) {
+        diff = ev->times[i] - until;
+        if (diff < oldest_diff) {
+          oldest_diff = diff;
+          oldest = i;
+        }
+      }
+    }
+
+    if (oldest_diff <= 0) {
+      time = ev->times[oldest];
+      ev->times[oldest] = 0;
+      elprintf(ev->log_mask, "%s: run event #%d %u", ev->name, oldest, time);
+      ev->cbs[oldest](time);
+    }
+    else if (oldest_diff < 0x7fffffff) {
+      ev->next = ev->times[oldest];
+      break;
+    }
+    else {
+      ev->next = 0;
+      break;
+    }
+  }
+
+  if (oldest != -1)
+    elprintf(ev->log_mask, "%s: next event #%d at %u", ev->name,
+      oldest, ev->next);
+}
+
+void pevents_register(struct pico_events *ev)
+{
+  int i;
+
+  for (i = 0; i < pevents_unit_count; i++)
+    if (pevents_units[i] == ev)
+      return;
+  if (pevents_unit_count < ARRAY_SIZE(pevents_units))
+    pevents_units[pevents_unit_count++] = ev;
+}
+
+// next event of all active units in ahw, in m68k cycles. 0 if none
+unsigned int pevents_next_m68k(int ahw)
+{
+  unsigned int next = 0, t;
+  int i;
+
+  for (i = 0; i < pevents_unit_count; i++) {
+    struct pico_events *ev = pevents_units[i];
+    if (!(ev->ahw & ahw & PicoIn.AHW) || ev->next == 0)
+      continue;
+    t = ev->to_m68k ? ev->to_m68k(ev->next) : ev->next;
+    if (next == 0 || CYCLES_GT(next, t))
+      next = t ? t : 1;
+  }
+  return next;
+}
+
+// recalculate next event after event times were changed externally
+void pevents_reset(struct pico_events *ev, unsigned int now)
+{
+  ev->next = 0;
+  pevents_run(ev, now);
+}
+
+// vim:shiftwidth=2:ts=2:expandtab
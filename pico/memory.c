@@ -801,12 +801,16 @@ static void psg_write_68k(u32 d)
 {
   PsndDoPSG(z80_cycles_from_68k());
   SN76496Write(d);
+  if (vgm_logging)
+    vgm_log_psg(d, z80_cycles_from_68k());
 }
 
 static void psg_write_z80(u32 d)
 {
   PsndDoPSG(z80_cyclesDone());
   SN76496Write(d);
+  if (vgm_logging)
+    vgm_log_psg(d, z80_cyclesDone());
 }
 
 // -----------------------------------------------------------------
@@ -1391,6 +1395,8 @@ static int ym2612_write_local(u32 a, u32 d, int is_from_z80)
     case 3: /* data port 1    */
       addr = ym2612.OPN.ST.address | ((int)ym2612.addr_A1 << 8);
       ym2612.REGS[addr] = d;
+      if (vgm_logging)
+        vgm_log_ym2612(ym2612.addr_A1, ym2612.OPN.ST.address, d, cycles);
 
       // the busy flag in the YM2612 status is actually a 32 cycle timer
       // (89.6 Z80 cycles), triggered by any write to the data port.
@@ -45,11 +45,13 @@ void PicoInit(void)
   PicoVideoInit();
   PicoDrawInit();
   PicoDraw2Init();
+  pevt_init();
 }
 
 // to be called once on emu exit
 void PicoExit(void)
 {
+  PicoVgmLogStop();
   PicoCartUnload();
   if (PicoIn.AHW & PAHW_MCD)
     PicoExitMCD();
@@ -76,6 +78,7 @@ void PicoPower(void)
   memset(&Pico.video,0,sizeof(Pico.video));
   memset(&Pico.m,0,sizeof(Pico.m));
   memset(&Pico.t,0,sizeof(Pico.t));
+  pstats_reset();
 
   // my MD1 VA6 console has this in IO
   PicoMem.ioports[1] = PicoMem.ioports[2] = PicoMem.ioports[3] = 0xff;
@@ -214,7 +217,7 @@ int PicoReset(void)
 
   // reinit, so that checksum checks pass
   if (!(PicoIn.opt & POPT_DIS_IDLE_DET))
-    SekInitIdleDet();
+    SekInitIdleDet(IDLE_DET_WARMUP);
 
   // reset sram state; enable sram access by default if it doesn't overlap with ROM
   Pico.m.sram_reg = 0;
@@ -276,8 +279,13 @@ PICO_INTERNAL void PicoSyncZ80(unsigned int m68k_cycles_done)
     Pico.t.z80c_cnt, Pico.t.z80c_cnt * 15 / 7 / 488,
     Pico.t.z80c_aim, Pico.t.z80c_aim * 15 / 7 / 488);
 
-  if (cnt > 0)
-    Pico.t.z80c_cnt += z80_run(cnt);
+  if (cnt > 0) {
+    pstats_start();
+    cnt = z80_run(cnt);
+    pstats_end(PSTATS_Z80);
+    Pico.t.z80c_cnt += cnt;
+    pstats_add(PSTATS_Z80, run, cnt);
+  }
 
   pprof_end(z80);
 }
@@ -313,6 +321,7 @@ void PicoFrame(void)
   PicoFrameHints();
 
 end:
+  pstats_frame_end();
   pprof_end(frame);
 }
 
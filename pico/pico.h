@@ -82,6 +82,8 @@ extern void *p32x_bios_g, *p32x_bios_m, *p32x_bios_s;
 #define POPT_FM_YM2612      (1<<24) //x00 0000
 #define POPT_EN_FM_FILTER   (1<<25)
 #define POPT_EN_KBD         (1<<26)
+#define POPT_DIS_LINE_MERGE (1<<27)
+#define POPT_DIS_SH2_TRACE  (1<<28)
 
 #define PAHW_MCD    (1<<0)
 #define PAHW_32X    (1<<1)
@@ -106,6 +108,7 @@ extern void *p32x_bios_g, *p32x_bios_m, *p32x_bios_s;
 #define PQUIRK_WWFRAW_HACK      (1<<2)
 #define PQUIRK_MARSCHECK_HACK   (1<<3)
 #define PQUIRK_NO_Z80_BUS_LOCK  (1<<4)
+#define PQUIRK_NO_IDLE_DET      (1<<5)
 
 // the emulator is configured and some status is reported
 // through this global state (not saved in savestates)
@@ -138,6 +141,7 @@ typedef struct PicoInterface
 	int sndFilterAlpha;            // Low pass sound filter alpha (Q16)
 	short *sndOut;                 // PCM output buffer
 	void (*writeSound)(int len);   // write .sndOut callback, called once per frame
+	int sndChunkLines;             // if set, also call writeSound every n lines, with .sndOut at the new part
 
 	void (*osdMessage)(const char *msg); // output OSD message from emu, optional
 
@@ -207,8 +211,15 @@ int PicoState(const char *fname, int is_save);
 int PicoStateLoadGfx(const char *fname);
 void *PicoTmpStateSave(void);
 void  PicoTmpStateRestore(void *data);
+size_t PicoStateFastSize(void);
+int PicoStateFastSave(void *buf, size_t size);
+int PicoStateFastLoad(const void *buf, size_t size);
 extern void (*PicoStateProgressCB)(const char *str);
 
+// sek.c
+int PicoIdleLoopsLoad(const char *fname);
+int PicoIdleLoopsSave(const char *fname);
+
 // cd/cdd.c
 int cdd_load(const char *filename, int type);
 int cdd_unload(void);
@@ -234,6 +245,8 @@ void     pm_sectorsize(int length, pm_file *stream);
 size_t   pm_read(void *ptr, size_t bytes, pm_file *stream);
 size_t   pm_read_audio(void *ptr, size_t bytes, pm_file *stream);
 int      pm_seek(pm_file *stream, long offset, int whence);
+const void *pm_map(pm_file *stream, size_t offset, size_t length);
+void     pm_set_cache_size(size_t bytes);
 int      pm_close(pm_file *fp);
 int PicoCartLoad(pm_file *f, const unsigned char *rom, unsigned int romsize,
   unsigned char **prom, unsigned int *psize, int is_sms);
@@ -241,6 +254,7 @@ int PicoCartInsert(unsigned char *rom, unsigned int romsize, const char *carthw_
 void PicoCartUnload(void);
 extern void (*PicoCartLoadProgressCB)(int percent);
 extern void (*PicoCDLoadProgressCB)(const char *fname, int percent);
+extern const char *PicoCDIndexDir; // where to keep CD track length indexes
 extern int PicoGameLoaded;
 
 // Draw.c
@@ -310,6 +324,11 @@ void Pico32xSetClocks(int msh2_hz, int ssh2_hz);
 extern void (*PsndMix_32_to_16)(s16 *dest, s32 *src, int count);
 void PsndRerate(int preserve_state);
 
+// sound/vgm.c
+// log all sound chip writes to a vgm file, starting with the current state
+int  PicoVgmLogStart(const char *fname);
+void PicoVgmLogStop(void);
+
 // media.c
 enum media_type_e {
   PM_BAD_DETECT = -1,
@@ -365,6 +384,34 @@ int PicoCdCheck(const char *fname_in, int *pregion);
 
 extern unsigned char media_id_header[0x100];
 
+// stats.c
+// cycles per cpu for each emulated frame. idle are cycles the cpu was skipped
+// for while stopped, polling or in an idle loop; stall are cycles lost to bus
+// contention. host_us is only measured if a clock is set.
+#define PSTATS_FRAMES 64
+enum { PSTATS_M68K, PSTATS_Z80, PSTATS_S68K, PSTATS_MSH2, PSTATS_SSH2, PSTATS_CPU_CNT };
+typedef struct
+{
+	unsigned int run, idle, stall;	/* in cycles of the cpu */
+	unsigned int host_us;
+} PicoCpuStats;
+// 32X sh2 synchronisation. slices are the sh2 runs toward a 68k target,
+// resyncs are extra runs of the other sh2 forced by cpu interaction.
+typedef struct
+{
+	unsigned int slices, slice_cycles;	/* slice_cycles in 68k cycles */
+	unsigned int resyncs, resync_cycles;	/* resync_cycles in 68k cycles */
+	unsigned int resync_us;
+} PicoSyncStats;
+typedef struct
+{
+	unsigned int frame;
+	PicoCpuStats cpu[PSTATS_CPU_CNT];
+	PicoSyncStats sync;
+} PicoFrameStats;
+int  PicoGetStats(PicoFrameStats *stats, int count); // last count frames, oldest 1st
+void PicoStatsSetClock(unsigned int (*get_ticks_us)(void));
+
 // memory.c
 enum input_device {
   PICO_INPUT_NOTHING,
@@ -50,8 +50,21 @@ static int SekSyncM68k(int once)
     // 16 bit value, but 68k is only blocked for ~16 cyc for the 2 bus cycles.
     if (z80_buscyc > cyc_do/2)
       z80_buscyc = cyc_do/2;
-    SekExecM68k(cyc_do - z80_buscyc);
+    // a stopped CPU which isn't woken up just consumes all cycles. Don't
+    // enter the CPU core in that case, it's the same but much faster.
+    if (SekIsStoppedM68k() && !SekShouldInterrupt()) {
+      Pico.t.m68c_cnt += cyc_do - z80_buscyc;
+      SekCyclesLeft = 0;
+      pstats_add(PSTATS_M68K, idle, cyc_do - z80_buscyc);
+    } else {
+      unsigned int cnt = Pico.t.m68c_cnt;
+      pstats_start();
+      SekExecM68k(cyc_do - z80_buscyc);
+      pstats_end(PSTATS_M68K);
+      pstats_add(PSTATS_M68K, run, Pico.t.m68c_cnt - cnt);
+    }
     Pico.t.m68c_cnt += z80_buscyc;
+    pstats_add(PSTATS_M68K, stall, z80_buscyc);
     Pico.t.z80_buscycles -= z80_buscyc<<4;
     if (once) break;
   }
@@ -107,9 +120,30 @@ static void do_hint(struct PicoVideo *pv)
   }
 }
 
+#ifdef PICO_CD
+// next event of an add-on whose CPU must be synced for it, since the woken
+// CPU might interrupt the 68k. The 32X SH2s can't, theirs are run lazily.
+#define PicoNextEvent() pevents_next_m68k(PAHW_MCD)
+#else
+#define PicoNextEvent() 0
+#endif
+
+// run sub CPUs up to an event due in this line. An idle sub CPU isn't synced
+// in CPUS_RUN and would otherwise only see it at the end of the display area.
+static void SyncEvents(void)
+{
+#ifdef PICO_CD
+  unsigned int next = PicoNextEvent();
+
+  if (next && CYCLES_GE(Pico.t.m68c_aim, next))
+    pcd_sync_s68k(Pico.t.m68c_aim, 0);
+#endif
+}
+
 static void do_timing_hacks_end(struct PicoVideo *pv)
 {
   PicoVideoFIFOSync(CYCLES_M68K_LINE);
+  SyncEvents();
 
   // need rather tight Z80 sync for emulation of main bus cycle stealing
   if (Pico.m.scanline&1)
@@ -128,10 +162,76 @@ static void do_timing_hacks_start(struct PicoVideo *pv)
   Pico.t.m68c_aim += Pico.m.scanline&1; // add 1 every 2 lines for 488.5 cycles
 }
 
+// Line merging. While the 68k is stopped without an irq to wake it, the Z80 is
+// held and the VDP FIFO is idle, no CPU can see the line timing. Such a line
+// only needs the cycle accounting SekRunM68k would do, which is done for all
+// lines up to the next event (H-int, sprite refresh, add-on event, end of the
+// line loop) at once. The line with the event is run normally, so results stay the same.
+// Returns the number of lines which can be skipped like this.
+static int PicoLinesIdle(struct PicoVideo *pv, int y, int y_end, int hint)
+{
+  int n = y_end - y - 1;
+
+  if (n <= 0 || (PicoIn.opt & POPT_DIS_LINE_MERGE))
+    return 0;
+  if (!SekIsStoppedM68k() || SekShouldInterrupt())
+    return 0;
+  if (Pico.m.z80Run && !Pico.m.z80_reset && (PicoIn.opt&POPT_EN_Z80))
+    return 0;
+  if (Pico.t.z80_buscycles || CYCLES_GT(Pico.t.m68c_cnt, Pico.t.m68c_aim))
+    return 0;
+  if (PicoLineHook || PicoIn.sndChunkLines || port_lightgun)
+    return 0;
+  if (!PicoVideoFIFOIdle())
+    return 0;
+#ifdef PICO_CD
+  if ((PicoIn.AHW & PAHW_MCD) && (Pico_mcd->m.state_flags &
+        (PCD_ST_M68K_POLL|PCD_ST_S68K_SYNC) ||
+      !(Pico_mcd->m.state_flags & (PCD_ST_S68K_POLL|PCD_ST_S68K_SLEEP))))
+    return 0; // the sub CPU is synced in pcd_run_cpus
+#endif
+#ifdef PICO_32X
+  if (Pico32x.emu_flags & (P32XF_68KCPOLL|P32XF_68KVPOLL))
+    return 0; // the SH2s are synced in CPUS_RUN
+#endif
+
+  if (hint >= 0 && (pv->reg[0] & 0x10) && n > hint)
+    n = hint;
+  if (!(pv->status & SR_VB) && Pico.est.DrawScanline >= y &&
+      n > Pico.est.DrawScanline - y)
+    n = Pico.est.DrawScanline - y; // PicoVideoFIFOHint refreshes sprites
+  return n > 0 ? n : 0;
+}
+
+static int PicoLinesSkip(struct PicoVideo *pv, int y, int n, int *hint,
+  int count_hint)
+{
+  unsigned int next = PicoNextEvent();
+  int delay, done;
+
+  for (done = 0; done < n; done++, y++) {
+    // stop at the line with the next event, see SyncEvents
+    if (next && CYCLES_GE(Pico.t.m68c_aim + CYCLES_M68K_LINE + (y&1), next))
+      break;
+    if (count_hint && --*hint < 0) {
+      *hint = pv->reg[10]; // H-int is disabled, see above
+      pv->pending_ints |= 0x10;
+    }
+    Pico.t.m68c_aim += y&1;
+    delay = (Pico.t.refresh_delay += CYCLES_M68K_LINE*0x108) >> 14;
+    Pico.t.refresh_delay -= delay << 14;
+    Pico.t.m68c_aim += CYCLES_M68K_LINE;
+    pstats_add(PSTATS_M68K, idle, Pico.t.m68c_aim - Pico.t.m68c_cnt - delay);
+    Pico.t.m68c_cnt = Pico.t.m68c_aim;
+    pevt_log_m68k_o(EVT_NEXT_LINE);
+  }
+  return done;
+}
+
 static int PicoFrameHints(void)
 {
   struct PicoVideo *pv = &Pico.video;
-  int lines, y, lines_vis, skip;
+  int lines, y, lines_vis, skip, n;
   int hint; // Hint counter
 
   pevt_log_m68k_o(EVT_FRAME_START);
@@ -152,6 +252,11 @@ static int PicoFrameHints(void)
     if (y == 224 && !(pv->reg[1] & 8))
       break;
 
+    if (!(PicoIn.opt & POPT_ALT_RENDERER) &&
+        (n = PicoLinesIdle(pv, y, (pv->reg[1] & 8) ? 240 : 224, hint))) {
+      y += PicoLinesSkip(pv, y, n, &hint, 1);
+    }
+
     Pico.m.scanline = y;
     pv->v_counter = PicoVideoGetV(y, 0);
 
@@ -186,6 +291,7 @@ static int PicoFrameHints(void)
     do_timing_hacks_end(pv);
 
     if (PicoLineHook) PicoLineHook();
+    if (unlikely(PicoIn.sndChunkLines)) PsndGetChunk(y);
     pevt_log_m68k_o(EVT_NEXT_LINE);
   }
 
@@ -270,6 +376,7 @@ static int PicoFrameHints(void)
   do_timing_hacks_end(pv);
 
   if (PicoLineHook) PicoLineHook();
+  if (unlikely(PicoIn.sndChunkLines)) PsndGetChunk(y);
   pevt_log_m68k_o(EVT_NEXT_LINE);
 
   if (Pico.m.z80Run && !Pico.m.z80_reset && (PicoIn.opt&POPT_EN_Z80))
@@ -280,6 +387,11 @@ static int PicoFrameHints(void)
   lines = Pico.m.pal ? 313 : 262;
   for (y++; y < lines - 1; y++)
   {
+    if ((n = PicoLinesIdle(pv, y, lines - 1,
+        (pv->status & PVS_ACTIVE) ? hint : -1))) {
+      y += PicoLinesSkip(pv, y, n, &hint, pv->status & PVS_ACTIVE);
+    }
+
     Pico.m.scanline = y;
     pv->v_counter = PicoVideoGetV(y, 1);
 
@@ -298,6 +410,7 @@ static int PicoFrameHints(void)
     do_timing_hacks_end(pv);
 
     if (PicoLineHook) PicoLineHook();
+    if (unlikely(PicoIn.sndChunkLines)) PsndGetChunk(y);
     pevt_log_m68k_o(EVT_NEXT_LINE);
   }
 
@@ -351,6 +464,8 @@ static int PicoFrameHints(void)
   PsndGetSamples(y);
 
   timers_cycle(cycles_68k_to_z80(Pico.t.m68c_aim - Pico.t.m68c_frame_start));
+  if (vgm_logging)
+    vgm_log_frame(cycles_68k_to_z80(Pico.t.m68c_aim - Pico.t.m68c_frame_start));
   z80_resetCycles();
 
   pv->hint_cnt = hint;
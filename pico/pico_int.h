@@ -709,11 +709,16 @@ typedef struct {
 extern carthw_state_chunk *carthw_chunks;
 #define CHUNK_CARTHW 64
 
+// flags for the *StateLoaded functions, set by PicoStateFastLoad
+#define PSL_FAST    (1 << 0) // RAM restored in native layout, SH2 code checked
+#define PSL_MAPS_OK (1 << 1) // banking registers unchanged, maps still valid
+
 // cart.c
 extern int rom_strcmp(void *rom, int size, int offset, const char *s1);
 extern void *PicoCartAlloc(int filesize, int is_sms);
 extern int PicoCartResize(int newsize);
 extern void Byteswap(void *dst, const void *src, int len);
+extern unsigned int rom_crc32(int size);
 extern void (*PicoCartMemSetup)(void);
 extern void (*PicoCartUnloadHook)(void);
 
@@ -817,7 +822,7 @@ u32 PicoRead8_mcd_io(u32 a);
 u32 PicoRead16_mcd_io(u32 a);
 void PicoWrite8_mcd_io(u32 a, u32 d);
 void PicoWrite16_mcd_io(u32 a, u32 d);
-void pcd_state_loaded_mem(void);
+void pcd_state_loaded_mem(int flags);
 
 // pico.c
 extern struct Pico Pico;
@@ -859,11 +864,12 @@ void pcd_event_schedule(unsigned int now, enum pcd_event event, int after);
 void pcd_event_schedule_s68k(enum pcd_event event, int after);
 void pcd_prepare_frame(void);
 unsigned int pcd_cycles_m68k_to_s68k(unsigned int c);
+int  pcd_s68k_frame_cycles(void);
 void pcd_irq_s68k(int irq, int state);
 int  pcd_sync_s68k(unsigned int m68k_target, int m68k_poll_sync);
 void pcd_run_cpus(int m68k_cycles);
 void pcd_soft_reset(void);
-void pcd_state_loaded(void);
+void pcd_state_loaded(int flags);
 
 // cd/pcm.c
 void pcd_pcm_sync(unsigned int to);
@@ -896,8 +902,12 @@ PICO_INTERNAL void SekSetRealTAS(int use_real);
 PICO_INTERNAL void SekPackCpu(unsigned char *cpu, int is_sub);
 PICO_INTERNAL void SekUnpackCpu(const unsigned char *cpu, int is_sub);
 void SekStepM68k(void);
-void SekInitIdleDet(void);
+void SekInitIdleDet(int warmup);
 void SekFinishIdleDet(void);
+int  SekIdleDetWarmup(void);
+void SekIdleLoopsClear(void);
+#define IDLE_DET_WARMUP 360 // frames until idle loop detection starts
+#define IDLE_DET_WARMUP_KNOWN 60 // same, with loops known from an earlier session
 #if defined(CPU_CMP_R) || defined(CPU_CMP_W)
 void SekTrace(int is_s68k);
 #else
@@ -986,6 +996,7 @@ unsigned char PicoVideoRead8HV_L(int is_from_z80);
 extern int (*PicoDmaHook)(u32 source, int len, unsigned short **base, u32 *mask);
 void PicoVideoFIFOSync(int cycles);
 int PicoVideoFIFOHint(void);
+int PicoVideoFIFOIdle(void);
 void PicoVideoFIFOMode(int active, int h40);
 int PicoVideoFIFOWrite(int count, int byte_p, unsigned sr_mask, unsigned sr_flags);
 void PicoVideoInit(void);
@@ -996,6 +1007,42 @@ int PicoVideoSave(void *buf);
 void PicoVideoLoad(void *buf, int len);
 void PicoVideoCacheSAT(int load);
 
+// events.c
+typedef void (event_cb)(unsigned int now);
+
+struct pico_events {
+  unsigned int *times;      // event times, 0 if not scheduled
+  event_cb * const *cbs;
+  int count;
+  unsigned int next;        // time of next event, 0 if none
+  int log_mask;
+  const char *name;
+  int ahw;                  // PAHW_* of the unit owning the queue
+  unsigned int (*to_m68k)(unsigned int t); // time in m68k cycles, NULL if same
+};
+
+void pevents_schedule(struct pico_events *ev, unsigned int now, int event, int after);
+void pevents_run(struct pico_events *ev, unsigned int until);
+void pevents_reset(struct pico_events *ev, unsigned int now);
+void pevents_register(struct pico_events *ev);
+unsigned int pevents_next_m68k(int ahw);
+
+// stats.c
+extern PicoFrameStats pstats_cur;
+extern unsigned int (*pstats_clock)(void);
+extern unsigned int pstats_acc;
+void pstats_time(int cpu, unsigned int t0, unsigned int acc0);
+void pstats_frame_end(void);
+void pstats_reset(void);
+
+#define pstats_add(c, what, cnt) \
+  pstats_cur.cpu[c].what += (cnt)
+#define pstats_start() { \
+  unsigned int pst_t0 = pstats_clock ? pstats_clock() : 0, pst_acc0 = pstats_acc
+#define pstats_end(c) \
+  if (pstats_clock) pstats_time(c, pst_t0, pst_acc0); \
+  }
+
 // misc.c
 PICO_INTERNAL_ASM void memcpy16bswap(unsigned short *dest, void *src, int count);
 PICO_INTERNAL_ASM void memset32(void *dest, int c, int count);
@@ -1031,6 +1078,17 @@ PICO_INTERNAL void PsndDoPCM(int cyc_to);
 PICO_INTERNAL void PsndClear(void);
 PICO_INTERNAL void PsndGetSamples(int y);
 PICO_INTERNAL void PsndGetSamplesMS(int y);
+PICO_INTERNAL void PsndGetChunk(int y);
+
+// sound/vgm.c
+extern int vgm_logging;
+void vgm_log_ym2612(int a1, int addr, int d, int z80_cycles);
+void vgm_log_psg(int d, int z80_cycles);
+void vgm_log_gg_stereo(int d, int z80_cycles);
+void vgm_log_ym2413(int port, int d, int z80_cycles);
+void vgm_log_pcm(int a, int d);
+void vgm_log_pcm_ram(int offs, const u8 *src, int len);
+void vgm_log_frame(int z80_cycles);
 
 // sms.c
 #ifndef NO_SMS
@@ -1065,6 +1123,10 @@ enum p32x_event {
   P32X_EVENT_HINT,
   P32X_EVENT_MTIMER,
   P32X_EVENT_STIMER,
+  P32X_EVENT_MDMA0,
+  P32X_EVENT_MDMA1,
+  P32X_EVENT_SDMA0,
+  P32X_EVENT_SDMA1,
   P32X_EVENT_COUNT,
 };
 extern unsigned int p32x_event_times[P32X_EVENT_COUNT];
@@ -1080,6 +1142,7 @@ void Pico32xDrawSync(SH2 *sh2);
 void Pico32xStateLoaded(int is_early);
 void Pico32xPrepare(void);
 void p32x_sync_sh2s(unsigned int m68k_target);
+extern unsigned int p32x_sync_events; // bumped on cpu interaction
 void p32x_sync_other_sh2(SH2 *sh2, unsigned int m68k_target);
 void p32x_update_irls(SH2 *active_sh2, unsigned int m68k_cycles);
 void p32x_trigger_irq(SH2 *sh2, unsigned int m68k_cycles, unsigned int mask);
@@ -1101,7 +1164,8 @@ void PicoWrite8_32x(u32 a, u32 d);
 void PicoWrite16_32x(u32 a, u32 d);
 void PicoMemSetup32x(void);
 void Pico32xSwapDRAM(int b);
-void Pico32xMemStateLoaded(void);
+void Pico32xMemStateLoaded(int flags);
+void p32x_sh2_ram_restore(int id, const void *src);
 void p32x_update_banks(void);
 void p32x_m68k_poll_event(u32 a, u32 flags);
 u32 REGPARM(3) p32x_sh2_poll_memory8(u32 a, u32 d, SH2 *sh2);
@@ -1142,6 +1206,8 @@ void p32x_pwm_state_loaded(void);
 // 32x/sh2soc.c
 void p32x_dreq0_trigger(void);
 void p32x_dreq1_trigger(void);
+void p32x_dmac_event(SH2 *sh2, int ch, unsigned int now);
+int  p32x_dmac_busy(SH2 *sh2);
 void p32x_timer_recalc(SH2 *sh2);
 void p32x_timer_do(SH2 *sh2, unsigned int now);
 void p32x_timer_irq(SH2 *sh2, unsigned int now);
@@ -1236,7 +1302,7 @@ do { \
 #define pprof_end_sub(...)
 #endif
 
-#ifdef EVT_LOG
+// CPU activity tracer, enabled at runtime by PICO_EVT_TRACE or PICO_EVT_LOG
 enum evt {
   EVT_FRAME_START,
   EVT_NEXT_LINE,
@@ -1255,25 +1321,25 @@ enum evt_cpu {
   EVT_CPU_CNT
 };
 
+extern int pevt_enabled;
+void pevt_init(void);
 void pevt_log(unsigned int cycles, enum evt_cpu c, enum evt e);
 void pevt_dump(void);
 
-#define pevt_log_m68k(e) \
-  pevt_log(SekCyclesDone(), EVT_M68K, e)
+#define pevt_log_m68k(e) do { \
+  if (unlikely(pevt_enabled)) \
+    pevt_log(SekCyclesDone(), EVT_M68K, e); \
+} while (0)
 #define pevt_log_m68k_o(e) \
-  pevt_log(SekCyclesDone(), EVT_M68K, e)
-#define pevt_log_sh2(sh2, e) \
-  pevt_log(sh2_cycles_done_m68k(sh2), EVT_MSH2 + (sh2)->is_slave, e)
-#define pevt_log_sh2_o(sh2, e) \
-  pevt_log((sh2)->m68krcycles_done, EVT_MSH2 + (sh2)->is_slave, e)
-#else
-#define pevt_log(c, e)
-#define pevt_log_m68k(e)
-#define pevt_log_m68k_o(e)
-#define pevt_log_sh2(sh2, e)
-#define pevt_log_sh2_o(sh2, e)
-#define pevt_dump()
-#endif
+  pevt_log_m68k(e)
+#define pevt_log_sh2(sh2, e) do { \
+  if (unlikely(pevt_enabled)) \
+    pevt_log(sh2_cycles_done_m68k(sh2), EVT_MSH2 + (sh2)->is_slave, e); \
+} while (0)
+#define pevt_log_sh2_o(sh2, e) do { \
+  if (unlikely(pevt_enabled)) \
+    pevt_log((sh2)->m68krcycles_done, EVT_MSH2 + (sh2)->is_slave, e); \
+} while (0)
 
 #ifdef __cplusplus
 } // End of extern "C"
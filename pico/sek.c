@@ -281,6 +281,13 @@ static unsigned short **idledet_ptrs = NULL;
 static int idledet_count = 0, idledet_bads = 0;
 static int idledet_start_frame = 0;
 
+// idle loops found in the ROM, as ROM offset and patched opcode. These are
+// kept across resets and can be stored for the next session, and they are
+// applied as soon as detection is ready.
+static struct idle_loop { u32 offs; u16 op; } *idleloops;
+static int idleloops_count, idleloops_applied, idleloops_dirty;
+static unsigned int idleloops_crc; // of the unpatched ROM
+
 #if 0
 #define IDLE_STATS 1
 unsigned int idlehit_addrs[128], idlehit_counts[128];
@@ -300,14 +307,103 @@ void SekRegisterIdleHit(unsigned int pc)
 }
 #endif
 
-void SekInitIdleDet(void)
+// called by the cpu core if an idle loop skips the rest of the timeslice
+void SekIdleSkipped(void *ctx, int cycles)
+{
+  int cpu = PSTATS_M68K;
+#ifdef EMU_F68K
+  if (ctx != &PicoCpuFM68k)
+    cpu = PSTATS_S68K;
+#endif
+  pstats_add(cpu, run, -cycles);
+  pstats_add(cpu, idle, cycles);
+}
+
+static int idledet_add(unsigned short *target)
+{
+  if (!idledet_ptrs || (idledet_count & 0x1ff) == 0) {
+    unsigned short **tmp;
+    tmp = realloc(idledet_ptrs, (idledet_count+0x200) * sizeof(tmp[0]));
+    if (tmp == NULL)
+      return 1;
+    idledet_ptrs = tmp;
+  }
+
+  idledet_ptrs[idledet_count++] = target;
+  return 0;
+}
+
+// original branch opcode of a patched one
+static int idledet_orig_op(int op)
+{
+  switch (op & 0xfd00) {
+    case 0x7100: return (op & 0xff) | 0x6600;
+    case 0x7500: return (op & 0xff) | 0x6700;
+    case 0x7d00: return (op & 0xff) | 0x6000;
+  }
+  return -1;
+}
+
+static void idleloops_add(u32 offs, int op)
+{
+  if ((idleloops_count & 0x3f) == 0) {
+    struct idle_loop *tmp;
+    tmp = realloc(idleloops, (idleloops_count+0x40) * sizeof(tmp[0]));
+    if (tmp == NULL)
+      return;
+    idleloops = tmp;
+  }
+
+  idleloops[idleloops_count].offs = offs;
+  idleloops[idleloops_count].op = op;
+  idleloops_count++;
+}
+
+static void idleloops_apply(void)
+{
+  int i, n = 0;
+
+  idleloops_applied = 1;
+#if defined(EMU_C68K) || defined(EMU_F68K)
+  for (i = 0; i < idleloops_count; i++) {
+    u16 *op = (u16 *)(Pico.rom + idleloops[i].offs);
+
+    // skip if the ROM doesn't match, e.g. due to cheat patches
+    if (idleloops[i].offs + 2 > Pico.romsize ||
+        *op != idledet_orig_op(idleloops[i].op))
+      continue;
+    if (idledet_add(op))
+      break;
+    *op = idleloops[i].op;
+    n++;
+  }
+#endif
+  elprintf(EL_IDLE, "idle: applied %i of %i known loops", n, idleloops_count);
+}
+
+void SekIdleLoopsClear(void)
+{
+  free(idleloops);
+  idleloops = NULL;
+  idleloops_count = idleloops_dirty = 0;
+  idleloops_crc = 0;
+}
+
+void SekInitIdleDet(int warmup)
 {
   idledet_count = idledet_bads = 0;
-  idledet_start_frame = Pico.m.frame_count + 360;
+  idledet_start_frame = Pico.m.frame_count + warmup;
+  idleloops_applied = 0;
 #ifdef IDLE_STATS
   idlehit_addrs[0] = 0;
 #endif
 
+  // game has been marked as not working with idle loop patches
+  if (PicoIn.quirks & PQUIRK_NO_IDLE_DET) {
+    idledet_count = -1;
+    return;
+  }
+
 #ifdef EMU_C68K
   CycloneInitIdle();
 #endif
@@ -318,7 +414,18 @@ void SekInitIdleDet(void)
 
 int SekIsIdleReady(void)
 {
-	return (Pico.m.frame_count >= idledet_start_frame);
+  if (Pico.m.frame_count < idledet_start_frame)
+    return 0;
+  if (!idleloops_applied)
+    idleloops_apply();
+  return 1;
+}
+
+// frames left until detection is started
+int SekIdleDetWarmup(void)
+{
+  int left = idledet_start_frame - Pico.m.frame_count;
+  return left > 0 ? left : 0;
 }
 
 int SekIsIdleCode(unsigned short *dst, int bytes)
@@ -332,7 +439,7 @@ int SekIsIdleCode(unsigned short *dst, int bytes)
       break;
     case 4:
       if ( (*dst & 0xff3f) == 0x4a38 || // tst.x ($xxxx.w); tas ($xxxx.w)
-           (*dst & 0xc1ff) == 0x0038 || // move.x ($xxxx.w), dX
+          ((*dst & 0xc1ff) == 0x0038 && (*dst & 0x3000)) || // move.x ($xxxx.w), dX
            (*dst & 0xf13f) == 0xb038)   // cmp.x ($xxxx.w), dX
         return 1;
       if (PicoIn.AHW & (PAHW_MCD|PAHW_32X))
@@ -348,11 +455,15 @@ int SekIsIdleCode(unsigned short *dst, int bytes)
             *dst == 0x4a39 ||            //   tst.b ($xxxxxxxx)
             *dst == 0x4a79 ||            //   tst.w ($xxxxxxxx)
             *dst == 0x4ab9 ||            //   tst.l ($xxxxxxxx)
-            (*dst & 0xc1ff) == 0x0039 || //   move.x ($xxxxxxxx), dX
+           ((*dst & 0xc1ff) == 0x0039 && (*dst & 0x3000)) || // move.x ($xxxxxxxx), dX
             (*dst & 0xf13f) == 0xb039))||//   cmp.x ($xxxxxxxx), dX
             *dst == 0x0838 ||            // btst $X, ($xxxx.w) [6 byte op]
             (*dst & 0xffbf) == 0x0c38)   // cmpi.{b,w} $X, ($xxxx.w)
         return 1;
+      if ( (*dst & 0xc1ff) == 0x0038 && (*dst & 0x3000) && // move.x ($xxxx.w), dX
+           (dst[2] & 0xff38) == 0x4a00 && // tst.x dX
+           (dst[2] & 7) == ((*dst >> 9) & 7))
+        return 1;
       break;
     case 8:
       if ( ((dst[2] & 0xe0) == 0xe0 && ( // RAM and
@@ -360,6 +471,11 @@ int SekIsIdleCode(unsigned short *dst, int bytes)
             (*dst & 0xffbf) == 0x0c39))||//   cmpi.{b,w} $X, ($xxxxxxxx)
             *dst == 0x0cb8)              // cmpi.l $X, ($xxxx.w)
         return 1;
+      if ( (*dst & 0xc1ff) == 0x0038 && (*dst & 0x3000) && // move.x ($xxxx.w), dX
+          ((dst[2] & 0xfff8) == 0x0800 || // btst $X, dX
+           (dst[2] & 0xffb8) == 0x0200) && // andi.{b,w} $X, dX
+           (dst[2] & 7) == ((*dst >> 9) & 7))
+        return 1;
       break;
     case 12:
       if (PicoIn.AHW & (PAHW_MCD|PAHW_32X))
@@ -404,16 +520,18 @@ int SekRegisterIdlePatch(unsigned int pc, int oldop, int newop, void *ctx)
       return 2; // remove detector
     return 1; // don't patch
   }
+  if (*target != oldop)
+    return 1; // already patched
 
-  if (!idledet_ptrs || (idledet_count & 0x1ff) == 0) {
-    unsigned short **tmp;
-    tmp = realloc(idledet_ptrs, (idledet_count+0x200) * sizeof(tmp[0]));
-    if (tmp == NULL)
-      return 1;
-    idledet_ptrs = tmp;
-  }
+  if (idledet_add(target))
+    return 1;
 
-  idledet_ptrs[idledet_count++] = target;
+  // remember patches in ROM, RAM contents are lost on reset anyway
+  if (is_main68k && (u8 *)target >= Pico.rom &&
+      (u8 *)target < Pico.rom + Pico.romsize) {
+    idleloops_add((u8 *)target - Pico.rom, newop);
+    idleloops_dirty = 1;
+  }
 
   return 0;
 }
@@ -431,12 +549,9 @@ void SekFinishIdleDet(void)
   while (idledet_count > 0)
   {
     unsigned short *op = idledet_ptrs[--idledet_count];
-    if      ((*op & 0xfd00) == 0x7100)
-      *op &= 0xff, *op |= 0x6600;
-    else if ((*op & 0xfd00) == 0x7500)
-      *op &= 0xff, *op |= 0x6700;
-    else if ((*op & 0xfd00) == 0x7d00)
-      *op &= 0xff, *op |= 0x6000;
+    int orig = idledet_orig_op(*op);
+    if (orig >= 0)
+      *op = orig;
     else
       elprintf(EL_STATUS|EL_IDLE, "idle: don't know how to restore %04x", *op);
   }
@@ -447,6 +562,89 @@ void SekFinishIdleDet(void)
   idledet_ptrs = NULL;
 }
 
+// load idle loops found for the current ROM in an earlier session
+int PicoIdleLoopsLoad(const char *fname)
+{
+  unsigned int crc, c, offs, op;
+  char buff[64];
+  FILE *f;
+
+  SekIdleLoopsClear();
+  // ROM isn't patched yet, remember the CRC for saving the list later
+  crc = idleloops_crc = rom_crc32(0);
+  f = fopen(fname, "r");
+  if (f == NULL)
+    return -1;
+
+  while (fgets(buff, sizeof(buff), f) != NULL) {
+    if (sscanf(buff, "%x %x %x", &c, &offs, &op) == 3 && c == crc &&
+        !(offs & 1) && idledet_orig_op(op) >= 0)
+      idleloops_add(offs, op);
+  }
+  fclose(f);
+
+  elprintf(EL_STATUS, "idle: %i known loops", idleloops_count);
+
+  // no need to wait for the loops to be found again. Some warmup is still
+  // needed for boot code which checksums the ROM, but that is done quickly
+  if (idleloops_count > 0 && idledet_start_frame >
+      Pico.m.frame_count + IDLE_DET_WARMUP_KNOWN)
+    idledet_start_frame = Pico.m.frame_count + IDLE_DET_WARMUP_KNOWN;
+  return 0;
+}
+
+// store idle loops of the current ROM, keeping those of other ROMs
+int PicoIdleLoopsSave(const char *fname)
+{
+  unsigned int crc, c;
+  char *data = NULL, *p, *e;
+  long size = 0;
+  FILE *f;
+  int i;
+
+  if (!idleloops_dirty || idleloops_crc == 0)
+    return 0;
+
+  f = fopen(fname, "r");
+  if (f != NULL) {
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size > 0 && (data = malloc(size + 1)) != NULL) {
+      size = fread(data, 1, size, f);
+      data[size] = 0;
+    } else
+      size = 0;
+    fclose(f);
+  }
+
+  f = fopen(fname, "w");
+  if (f == NULL) {
+    free(data);
+    return -1;
+  }
+
+  crc = idleloops_crc;
+  for (p = data; p != NULL && p < data + size; p = e) {
+    for (e = p; e < data + size && *e != '\n'; e++)
+      ;
+    if (e < data + size)
+      e++;
+    if (sscanf(p, "%x", &c) == 1 && c != crc) {
+      fwrite(p, 1, e - p, f);
+      if (e[-1] != '\n')
+        fputc('\n', f);
+    }
+  }
+  for (i = 0; i < idleloops_count; i++)
+    fprintf(f, "%08x %06x %04x\n", crc, idleloops[i].offs, idleloops[i].op);
+  fclose(f);
+  free(data);
+
+  idleloops_dirty = 0;
+  return 0;
+}
+
 
 #if defined(CPU_CMP_R) || defined(CPU_CMP_W)
 #include "debug.h"
@@ -551,10 +551,14 @@ static void z80_sms_out(unsigned short a, unsigned char d)
           // FM reg port
           Pico.m.hardware |= PMS_HW_FMUSED;
           YM2413_regWrite(d);
+          if (vgm_logging)
+            vgm_log_ym2413(0, d, z80_cyclesDone());
           break;
         case 0xf1:
           // FM data port
           YM2413_dataWrite(d);
+          if (vgm_logging)
+            vgm_log_ym2413(1, d, z80_cyclesDone());
           break;
         case 0xf2:
           // bit 0 = 1 active FM Pac
@@ -569,8 +573,11 @@ static void z80_sms_out(unsigned short a, unsigned char d)
       case 0x00:
         if ((PicoIn.AHW & PAHW_GG) && a < 0x8)   // GG I/O area
           Pico.ms.io_gg[a] = d;
-        if ((PicoIn.AHW & PAHW_GG) && a == 0x6)
+        if ((PicoIn.AHW & PAHW_GG) && a == 0x6) {
           SN76496Config(d);
+          if (vgm_logging)
+            vgm_log_gg_stereo(d, z80_cyclesDone());
+        }
         break;
       case 0x01:
         if ((PicoIn.AHW & PAHW_GG) && a < 0x8) { // GG I/O area
@@ -587,6 +594,8 @@ static void z80_sms_out(unsigned short a, unsigned char d)
       case 0x41:
         PsndDoPSG(z80_cyclesDone());
         SN76496Write(d);
+        if (vgm_logging)
+          vgm_log_psg(d, z80_cyclesDone());
         break;
 
       case 0x80:
@@ -642,8 +651,14 @@ static void z80_sms_out(unsigned short a, unsigned char d)
 
 static void z80_exec(int aim)
 {
+  int cycles;
+
   Pico.t.z80c_aim = aim;
-  Pico.t.z80c_cnt += z80_run(Pico.t.z80c_aim - Pico.t.z80c_cnt);
+  pstats_start();
+  cycles = z80_run(Pico.t.z80c_aim - Pico.t.z80c_cnt);
+  pstats_end(PSTATS_Z80);
+  Pico.t.z80c_cnt += cycles;
+  pstats_add(PSTATS_Z80, run, cycles);
 }
 
 
@@ -1332,6 +1347,7 @@ void PicoFrameMS(void)
       PicoLineSMS(y);
 
     z80_exec(Pico.t.z80c_line_start + cycles_line);
+    if (unlikely(PicoIn.sndChunkLines)) PsndGetChunk(y);
   }
 
   // end of frame updates
@@ -1340,6 +1356,8 @@ void PicoFrameMS(void)
   tape.cycle -= Pico.t.z80c_aim;
   tape.phase -= Pico.t.z80c_aim;
 
+  if (vgm_logging)
+    vgm_log_frame(Pico.t.z80c_aim);
   z80_resetCycles();
   PsndGetSamplesMS(lines);
 }
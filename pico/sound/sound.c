@@ -25,6 +25,9 @@ void (*PsndMix_32_to_16)(s16 *dest, s32 *src, int count) = mix_32_to_16_stereo;
 // +1 for a fill triggered by an instruction overhanging into the next scanline
 static s32 PsndBuffer[2*(54000+100)/50+2];
 
+// samples already handed to the frontend in the current frame
+static int PsndChunkPos;
+
 // cdda output buffer
 s16 cdda_out_buffer[2*1152];
 
@@ -469,6 +472,7 @@ PICO_INTERNAL void PsndClear(void)
 
   // drop pos remainder to avoid rounding errors (not entirely correct though)
   Pico.snd.dac_pos = Pico.snd.fm_pos = Pico.snd.psg_pos = Pico.snd.ym2413_pos = Pico.snd.pcm_pos = 0;
+  PsndChunkPos = 0;
   if (!PicoIn.sndOut) return;
 
   if (PicoIn.opt & POPT_EN_STEREO)
@@ -572,14 +576,29 @@ static int PsndRender(int offset, int length)
   return length;
 }
 
+// hand the samples from pos to end over to the frontend
+static void PsndWrite(int pos, int end)
+{
+  int stereo = (PicoIn.opt & 8) >> 3;
+  s16 *out = PicoIn.sndOut;
+
+  if (!PicoIn.writeSound || !out || end <= pos)
+    return;
+
+  PicoIn.sndOut = out + (pos << stereo);
+  PicoIn.writeSound((end - pos) << (stereo + 1));
+  // the frontend may have switched to another buffer
+  if (PicoIn.sndOut == out + (pos << stereo))
+    PicoIn.sndOut = out;
+}
+
 PICO_INTERNAL void PsndGetSamples(int y)
 {
   static int curr_pos = 0;
 
-  curr_pos  = PsndRender(0, Pico.snd.len_use);
+  curr_pos  = PsndRender(PsndChunkPos, Pico.snd.len_use);
 
-  if (PicoIn.writeSound && PicoIn.sndOut)
-    PicoIn.writeSound(curr_pos * ((PicoIn.opt & POPT_EN_STEREO) ? 4 : 2));
+  PsndWrite(PsndChunkPos, curr_pos);
   // clear sound buffer
   PsndClear();
 }
@@ -631,11 +650,46 @@ PICO_INTERNAL void PsndGetSamplesMS(int y)
 {
   static int curr_pos = 0;
 
-  curr_pos  = PsndRenderMS(0, Pico.snd.len_use);
+  curr_pos  = PsndRenderMS(PsndChunkPos, Pico.snd.len_use);
 
-  if (PicoIn.writeSound != NULL && PicoIn.sndOut)
-    PicoIn.writeSound(curr_pos * ((PicoIn.opt & POPT_EN_STEREO) ? 4 : 2));
+  PsndWrite(PsndChunkPos, curr_pos);
   PsndClear();
 }
 
+// Deliver sound in the middle of a frame, every PicoIn.sndChunkLines lines.
+// The chips are timed by the z80, or by the 68k while the z80 is stopped, so
+// everything up to where both have run is final and the chip output is the
+// same as with a single write at the end of the frame. CD PCM and PWM are
+// stretched over each chunk instead of the whole frame.
+PICO_INTERNAL void PsndGetChunk(int y)
+{
+  int cyc, pos;
+
+  if ((y + 1) % PicoIn.sndChunkLines || !PicoIn.writeSound || !PicoIn.sndOut)
+    return;
+
+  if (PicoIn.AHW & PAHW_SMS)
+    cyc = z80_cyclesDone();
+  else {
+    cyc = cycles_68k_to_z80(Pico.t.m68c_aim - Pico.t.m68c_frame_start);
+    if (Pico.m.z80Run && !Pico.m.z80_reset && (PicoIn.opt & POPT_EN_Z80)
+        && z80_cyclesDone() < cyc)
+      cyc = z80_cyclesDone();
+  }
+
+  // keep at least 1 sample for the frame end, CD PCM and PWM need a length
+  pos = (cyc * Pico.snd.clkz_mult + 0x80000) >> 20;
+  if (pos > Pico.snd.len_use - 1)
+    pos = Pico.snd.len_use - 1;
+  if (pos <= PsndChunkPos)
+    return;
+
+  if (PicoIn.AHW & PAHW_SMS)
+    PsndRenderMS(PsndChunkPos, pos);
+  else
+    PsndRender(PsndChunkPos, pos);
+  PsndWrite(PsndChunkPos, pos);
+  PsndChunkPos = pos;
+}
+
 // vim:shiftwidth=2:ts=2:expandtab
@@ -240,11 +240,10 @@ static int try_start_stream(struct vgm *vgm, struct vgm_stream *stream,
   return 1;
 }
 
-int rf5c164_write(struct vgm *vgm, size_t cmd_pos,
-    u32 doffset, const u8 *src, u32 soffset, u32 length)
+static int rf5c164_write(size_t cmd_pos, u32 doffset,
+    const u8 *src, size_t slength, u32 soffset, u32 length)
 {
   // affected by current bank, but can go to further banks by using offset
-  size_t slength = vgm->blocks[0].end - vgm->blocks[0].start;
   if (soffset >= slength || soffset + length > slength ||
       (Pico_mcd->pcm.bank << 12) + doffset >= sizeof(Pico_mcd->pcm_ram) ||
       (Pico_mcd->pcm.bank << 12) + doffset + length > sizeof(Pico_mcd->pcm_ram))
@@ -392,7 +391,7 @@ void vgm_frame(void)
               goto bad;
             doffset = get16(&fdata);
             length -= 2;
-            rf5c164_write(vgm, cmd_pos, doffset, fdata, 0, length);
+            rf5c164_write(cmd_pos, doffset, fdata, length, 0, length);
             break;
           default:
           bad:
@@ -412,8 +411,8 @@ void vgm_frame(void)
           switch (type)
           {
           case BLOCK_TYPE_RF5C164:
-            rf5c164_write(vgm, cmd_pos, doffset, vgm->data + vgm->blocks[0].start,
-                offset32, length);
+            rf5c164_write(cmd_pos, doffset, vgm->data + vgm->blocks[0].start,
+                vgm->blocks[0].end - vgm->blocks[0].start, offset32, length);
             break;
           default:
             elprintf(EL_VGM | EL_ANOMALY, "vgm: %06zx: unhandled pcm ram type %02x",
@@ -542,6 +541,11 @@ void vgm_frame(void)
           data = *fdata++;
           pcd_pcm_write(addr, data);
           break;
+        case 0xC1: // RF5C164, memory write
+          doffset = get16(&fdata);
+          data = *fdata++;
+          Pico_mcd->pcm_ram_b[Pico_mcd->pcm.bank][doffset & 0xfff] = data;
+          break;
         case 0xe0: // seek to offset
           offset32 = get32(&fdata);
           if (offset32 < vgm->blocks[0].end - vgm->blocks[0].start) // always block 0?
@@ -626,6 +630,11 @@ void vgm_frame(void)
   Pico.m.frame_count++;
 }
 
+int vgm_done(void)
+{
+  return g_vgm == NULL || g_vgm->data_pos >= g_vgm->data_size;
+}
+
 void vgm_reset(void)
 {
   if (g_vgm)
@@ -641,4 +650,226 @@ void vgm_finish(void)
   }
 }
 
+/*
+ * logging of sound chip writes to a vgm file.
+ * Writes are timestamped in z80 cycles since the frame start, which are
+ * converted to 44100Hz samples when a command is written.
+ */
+int vgm_logging;
+
+static struct {
+  FILE *f;
+  u64 zcyc_base;   // z80 cycles at start of the current frame
+  u64 samples;     // samples written so far
+  u32 osc;
+  u32 chips;
+  int ym2413_addr;
+} vgm_log;
+
+#define LOG_YM2612  (1 << 0)
+#define LOG_PSG     (1 << 1)
+#define LOG_YM2413  (1 << 2)
+#define LOG_RF5C164 (1 << 3)
+
+static void put_le(u8 *p, u32 v, int n)
+{
+  while (n--)
+    *p++ = v, v >>= 8;
+}
+
+static void log_wait(int z80_cycles)
+{
+  u64 to = (vgm_log.zcyc_base + z80_cycles) * 15 * 44100 / vgm_log.osc;
+  u8 cmd[3];
+  u32 n;
+
+  while (to > vgm_log.samples) {
+    n = to - vgm_log.samples < 0xffff ? to - vgm_log.samples : 0xffff;
+    if (n == 735 || n == 882)
+      cmd[0] = n == 735 ? 0x62 : 0x63, fwrite(cmd, 1, 1, vgm_log.f);
+    else if (n <= 16)
+      cmd[0] = 0x70 + n-1, fwrite(cmd, 1, 1, vgm_log.f);
+    else {
+      cmd[0] = 0x61, put_le(cmd+1, n, 2);
+      fwrite(cmd, 1, 3, vgm_log.f);
+    }
+    vgm_log.samples += n;
+  }
+}
+
+static void log_cmd(int z80_cycles, u8 c, u8 a, u8 d)
+{
+  u8 cmd[3] = { c, a, d };
+
+  log_wait(z80_cycles);
+  fwrite(cmd, 1, (c == 0x50 || c == 0x4f) ? 2 : 3, vgm_log.f);
+}
+
+static void log_pcm_block(int offs, const u8 *src, int len)
+{
+  u8 hdr[9] = { 0x67, 0x66, 0xc1 };
+
+  put_le(hdr+3, len + 2, 4);
+  put_le(hdr+7, offs, 2);
+  fwrite(hdr, 1, sizeof(hdr), vgm_log.f);
+  fwrite(src, 1, len, vgm_log.f);
+}
+
+// main 68k time of the sub 68k, in z80 cycles since frame start
+static int pcm_z80_cycles(void)
+{
+  return cycles_68k_to_z80(pcd_s68k_frame_cycles());
+}
+
+void vgm_log_ym2612(int a1, int addr, int d, int z80_cycles)
+{
+  vgm_log.chips |= LOG_YM2612;
+  log_cmd(z80_cycles, 0x52 + a1, addr, d);
+}
+
+void vgm_log_psg(int d, int z80_cycles)
+{
+  vgm_log.chips |= LOG_PSG;
+  log_cmd(z80_cycles, 0x50, d, 0);
+}
+
+void vgm_log_gg_stereo(int d, int z80_cycles)
+{
+  log_cmd(z80_cycles, 0x4f, d, 0);
+}
+
+void vgm_log_ym2413(int port, int d, int z80_cycles)
+{
+  if (port == 0) {
+    vgm_log.ym2413_addr = d;
+    return;
+  }
+  vgm_log.chips |= LOG_YM2413;
+  log_cmd(z80_cycles, 0x51, vgm_log.ym2413_addr, d);
+}
+
+void vgm_log_pcm(int a, int d)
+{
+  vgm_log.chips |= LOG_RF5C164;
+  log_cmd(pcm_z80_cycles(), 0xb1, a, d);
+}
+
+void vgm_log_pcm_ram(int offs, const u8 *src, int len)
+{
+  u8 cmd[4] = { 0xc1 };
+
+  vgm_log.chips |= LOG_RF5C164;
+  log_wait(pcm_z80_cycles());
+  if (len == 1) {
+    put_le(cmd+1, offs, 2);
+    cmd[3] = *src;
+    fwrite(cmd, 1, 4, vgm_log.f);
+  } else
+    log_pcm_block(offs, src, len);
+}
+
+void vgm_log_frame(int z80_cycles)
+{
+  log_wait(z80_cycles);
+  vgm_log.zcyc_base += z80_cycles;
+}
+
+int PicoVgmLogStart(const char *fname)
+{
+  u8 hdr[0x80] = { 'V', 'g', 'm', ' ' };
+  int i, r, a1, bank;
+
+  PicoVgmLogStop();
+  vgm_log.f = fopen(fname, "wb");
+  if (vgm_log.f == NULL)
+    return -1;
+  // header is filled in when logging is stopped
+  fwrite(hdr, 1, sizeof(hdr), vgm_log.f);
+
+  vgm_log.osc = Pico.m.pal ? OSC_PAL : OSC_NTSC;
+  vgm_log.zcyc_base = vgm_log.samples = 0;
+  vgm_log.chips = 0;
+  vgm_logging = 1;
+
+  // start with the current chip state, as far as it is known
+  if (!(PicoIn.AHW & PAHW_SMS)) {
+    for (i = 0x21; i < 0xb7; i++) {
+      if (i == 0x28 || (i >= 0x24 && i <= 0x26))
+        continue;
+      if ((i & 0xf4) == 0xa0)
+        continue; // done together with 0xa4-0xa6/0xac-0xae below
+      for (a1 = 0; a1 < (i >= 0x30 ? 2 : 1); a1++) {
+        vgm_log_ym2612(a1, i, ym2612.REGS[(a1 << 8) | i], 0);
+        // the upper frequency bits only go to a latch shared by all
+        // channels, writing the lower bits commits them
+        if ((i & 0xf4) == 0xa4)
+          vgm_log_ym2612(a1, i - 4, ym2612.REGS[(a1 << 8) | (i - 4)], 0);
+      }
+    }
+    // leave the latches as they are now
+    vgm_log_ym2612(0, 0xa4, ym2612.OPN.ST.fn_h, 0);
+    vgm_log_ym2612(0, 0xac, ym2612.OPN.SL3.fn_h, 0);
+  }
+
+  // PSG tone, volume and noise registers. The latched register goes last,
+  // so that following data bytes go to the same register as on the chip
+  for (i = 1; i <= 8; i++) {
+    r = (sn76496_regs[8] + i) & 7; // LastRegister
+    vgm_log_psg(0x80 | (r << 4) | (sn76496_regs[r] & 0x0f), 0);
+    if (r == 0 || r == 2 || r == 4) // tone period has 6 more bits
+      vgm_log_psg((sn76496_regs[r] >> 4) & 0x3f, 0);
+  }
+  if ((PicoIn.AHW & PAHW_MCD) && Pico_mcd != NULL) {
+    for (bank = 0; bank < 0x10; bank++) {
+      vgm_log_pcm(7, bank);
+      log_pcm_block(0, Pico_mcd->pcm_ram_b[bank], 0x1000);
+    }
+    for (i = 0; i < 8; i++) {
+      vgm_log_pcm(7, 0x40 | i);
+      for (bank = 0; bank < 7; bank++)
+        vgm_log_pcm(bank, Pico_mcd->pcm.ch[i].regs[bank]);
+    }
+    vgm_log_pcm(7, Pico_mcd->pcm.control);
+    vgm_log_pcm(8, ~Pico_mcd->pcm.enabled & 0xff);
+  }
+  return 0;
+}
+
+void PicoVgmLogStop(void)
+{
+  u8 hdr[0x80] = { 'V', 'g', 'm', ' ' };
+  u32 clk_psg = 0, clk_fm = 0;
+  u8 end = 0x66;
+  long size;
+
+  if (vgm_log.f == NULL)
+    return;
+  vgm_logging = 0;
+  fwrite(&end, 1, 1, vgm_log.f);
+  size = ftell(vgm_log.f);
+
+  if (vgm_log.chips & LOG_PSG)
+    clk_psg = vgm_log.osc / 15;
+  if (vgm_log.chips & LOG_YM2413)
+    clk_fm = vgm_log.osc / 15;
+  put_le(hdr+0x04, size - 0x04, 4);
+  put_le(hdr+0x08, 0x161, 4);
+  put_le(hdr+0x0c, clk_psg, 4);
+  put_le(hdr+0x10, clk_fm, 4);
+  put_le(hdr+0x18, vgm_log.samples, 4);
+  put_le(hdr+0x24, vgm_log.osc == OSC_PAL ? 50 : 60, 4);
+  put_le(hdr+0x28, 0x0009, 2);  // sn76489 feedback, shift width
+  hdr[0x2a] = 16;
+  if (vgm_log.chips & LOG_YM2612)
+    put_le(hdr+0x2c, vgm_log.osc / 7, 4);
+  put_le(hdr+0x34, sizeof(hdr) - 0x34, 4);
+  if (vgm_log.chips & LOG_RF5C164)
+    put_le(hdr+0x6c, 12500000, 4);
+
+  fseek(vgm_log.f, 0, SEEK_SET);
+  fwrite(hdr, 1, sizeof(hdr), vgm_log.f);
+  fclose(vgm_log.f);
+  vgm_log.f = NULL;
+}
+
 // vim:ts=2:sw=2:expandtab
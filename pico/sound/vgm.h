@@ -2,5 +2,6 @@
 int  vgm_load(const char *fname);
 void vgm_frame(void);
 void vgm_reset(void);
+int  vgm_done(void);
 void vgm_finish(void);
 
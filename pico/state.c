@@ -243,6 +243,7 @@ static int state_save(void *file)
 
   if (!(PicoIn.AHW & PAHW_SMS)) {
     // the patches can cause incompatible saves with no-idle
+    int idle_warmup = SekIdleDetWarmup();
     SekFinishIdleDet();
 
     memset(buff, 0, sizeof(buff));
@@ -271,8 +272,9 @@ static int state_save(void *file)
 #endif
     }
 
+    // resume detection, no need to wait for the game to boot again
     if (!(PicoIn.opt & POPT_DIS_IDLE_DET))
-      SekInitIdleDet();
+      SekInitIdleDet(idle_warmup);
   }
   else {
     CHECKED_WRITE_BUFF(CHUNK_SMS, Pico.ms);
@@ -640,7 +642,7 @@ readend:
   if (PicoIn.AHW & PAHW_32X)
     Pico32xStateLoaded(0);
   if (PicoIn.AHW & PAHW_MCD)
-    pcd_state_loaded();
+    pcd_state_loaded(0);
   if (!(PicoIn.AHW & PAHW_SMS)) {
     Pico.video.status &= ~(SR_VB | SR_F);
     Pico.video.status |= ((Pico.video.reg[1] >> 3) ^ SR_VB) & SR_VB;
@@ -760,6 +762,324 @@ int PicoStateFP(void *afile, int is_save,
   return pico_state_internal(afile, is_save);
 }
 
+// Fast in-memory states for rollback netplay and runahead. There are no chunk
+// headers, the layout is fixed by the hardware config and packed parts go to
+// fixed size slots. They are meant to be loaded into the running instance only,
+// so RAM is kept in native layout, static BIOS images are left out and on load
+// memory maps are only rebuilt if the banking registers have changed.
+struct fast_hdr {
+  char magic[8];
+  unsigned int ahw;
+  unsigned int size;
+};
+
+enum { FS_SIZE, FS_SAVE, FS_LOAD };
+
+struct fast_state {
+  u8 *buf;
+  size_t pos;
+  int mode;
+  int carthw_changed;
+  u8 *m68k, *s68k, *z80, *vdp;  // to be unpacked after the maps are set up
+  int vdp_len;
+};
+
+#define FAST_SLOT     0x1000           // sound chips, io ports
+#define FAST_SLOT_CD  (CHUNK_LIMIT_W + 4)
+
+static void fast_buff(struct fast_state *fs, void *data, size_t len)
+{
+  if (fs->mode == FS_SAVE)
+    memcpy(fs->buf + fs->pos, data, len);
+  else if (fs->mode == FS_LOAD)
+    memcpy(data, fs->buf + fs->pos, len);
+  fs->pos += len;
+}
+
+// reserve len bytes, returns NULL if only counting the size
+static u8 *fast_slot(struct fast_state *fs, size_t len)
+{
+  u8 *p = (fs->mode == FS_SIZE ? NULL : fs->buf + fs->pos);
+  fs->pos += len;
+  return p;
+}
+
+#define FAST_BUFF(buff) \
+  fast_buff(fs, &buff, sizeof(buff))
+
+// packed data at d+4 with its length in front, save_expr returns the length
+#define FAST_PACKED(slot, save_expr, load_stmt) { \
+  u8 *d = fast_slot(fs, slot); \
+  int len; \
+  if (fs->mode == FS_SAVE) { \
+    len = save_expr; \
+    if (len < 0 || len > (slot) - 4) \
+      return -1; \
+    memcpy(d, &len, 4); \
+  } else if (fs->mode == FS_LOAD) { \
+    memcpy(&len, d, 4); \
+    load_stmt; \
+  } \
+}
+
+static int fast_state_io(struct fast_state *fs)
+{
+  u8 *d;
+
+  if (!(PicoIn.AHW & PAHW_SMS)) {
+    d = fast_slot(fs, 0x60);
+    if (fs->mode == FS_SAVE) {
+      memset(d, 0, 0x60);
+      SekPackCpu(d, 0);
+    }
+    fs->m68k = d;
+    FAST_BUFF(PicoMem.ram);
+    FAST_BUFF(PicoMem.vsram);
+    FAST_PACKED(FAST_SLOT, io_ports_pack(d + 4, FAST_SLOT - 4),
+      io_ports_unpack(d + 4, len));
+    if (PicoIn.AHW & PAHW_PICO) {
+      FAST_PACKED(FAST_SLOT, PicoPicoPCMSave(d + 4, FAST_SLOT - 4),
+        PicoPicoPCMLoad(d + 4, len));
+      FAST_BUFF(PicoPicohw);
+    } else {
+#ifdef __GP2X__
+      FAST_PACKED(FAST_SLOT, (ym2612_pack_state_old(),
+          memcpy(d + 4, YM2612GetRegs(), 0x200+4), 0x200+4),
+        (memcpy(YM2612GetRegs(), d + 4, 0x200+4), ym2612_unpack_state_old()));
+#else
+      FAST_PACKED(FAST_SLOT, YM2612PicoStateSave3(d + 4, FAST_SLOT - 4),
+        YM2612PicoStateLoad3(d + 4, len));
+      FAST_PACKED(FAST_SLOT, ym2612_pack_timers(d + 4, FAST_SLOT - 4),
+        ym2612_unpack_timers(d + 4, len));
+#endif
+    }
+  }
+  else {
+    FAST_BUFF(Pico.ms);
+    FAST_PACKED(FAST_SLOT, opll ? ym2413_pack_state(d + 4, FAST_SLOT - 4) : 0,
+      if (len) ym2413_unpack_state(d + 4, len));
+  }
+  fast_buff(fs, sn76496_regs, 28*4);
+
+  if (!(PicoIn.AHW & PAHW_PICO)) {
+    d = fast_slot(fs, Z80_STATE_SIZE);
+    if (fs->mode == FS_SAVE)
+      z80_pack(d);
+    fs->z80 = d;
+    FAST_BUFF(PicoMem.zram);
+  }
+
+  FAST_BUFF(PicoMem.vram);
+  FAST_BUFF(PicoMem.cram);
+  FAST_BUFF(Pico.m);
+  FAST_PACKED(0x200 + 4, PicoVideoSave(d + 4),
+    (fs->vdp = d + 4, fs->vdp_len = len));
+  FAST_BUFF(Pico.video);
+
+  if (PicoIn.AHW & PAHW_MCD)
+  {
+    d = fast_slot(fs, 0x60);
+    if (fs->mode == FS_SAVE) {
+      memset(d, 0, 0x60);
+      SekPackCpu(d, 1);
+      memcpy(&Pico_mcd->m.hint_vector, Pico_mcd->bios + 0x72,
+        sizeof(Pico_mcd->m.hint_vector));
+    }
+    fs->s68k = d;
+    FAST_BUFF(Pico_mcd->prg_ram);
+    FAST_BUFF(Pico_mcd->word_ram2M); // as is, in 1M or 2M layout
+    FAST_BUFF(Pico_mcd->pcm_ram);
+    FAST_BUFF(Pico_mcd->bram);
+    FAST_BUFF(Pico_mcd->s68k_regs);
+    FAST_BUFF(Pico_mcd->pcm);
+    FAST_BUFF(Pico_mcd->m);
+    FAST_BUFF(pcd_event_times);
+    FAST_PACKED(FAST_SLOT_CD, gfx_context_save(d + 4), gfx_context_load(d + 4));
+    FAST_PACKED(FAST_SLOT_CD, cdc_context_save(d + 4), cdc_context_load(d + 4));
+    FAST_PACKED(FAST_SLOT_CD, cdd_context_save(d + 4), cdd_context_load(d + 4));
+    FAST_BUFF(Pico_msd);
+  }
+
+#ifndef NO_32X
+  if (PicoIn.AHW & PAHW_32X)
+  {
+    int i;
+
+    for (i = 0; i < 2; i++) {
+      d = fast_slot(fs, SH2_STATE_SIZE);
+      if (fs->mode == FS_SAVE) {
+        memset(d, 0, SH2_STATE_SIZE);
+        sh2_pack(&sh2s[i], d);
+      } else if (fs->mode == FS_LOAD)
+        sh2_unpack(&sh2s[i], d);
+
+      d = fast_slot(fs, sizeof(sh2s[i].data_array));
+      if (fs->mode == FS_SAVE)
+        memcpy(d, sh2s[i].data_array, sizeof(sh2s[i].data_array));
+      else if (fs->mode == FS_LOAD)
+        p32x_sh2_ram_restore(1 + i, d);
+      FAST_BUFF(sh2s[i].peri_regs);
+    }
+
+    FAST_BUFF(Pico32x);
+    FAST_BUFF(Pico32xMem->m68k_rom);
+    d = fast_slot(fs, sizeof(Pico32xMem->sdram));
+    if (fs->mode == FS_SAVE)
+      memcpy(d, Pico32xMem->sdram, sizeof(Pico32xMem->sdram));
+    else if (fs->mode == FS_LOAD)
+      p32x_sh2_ram_restore(0, d);
+    FAST_BUFF(Pico32xMem->dram);
+    FAST_BUFF(Pico32xMem->pal);
+    FAST_BUFF(p32x_event_times);
+  }
+#endif
+
+  if (carthw_chunks != NULL)
+  {
+    carthw_state_chunk *chwc;
+    for (chwc = carthw_chunks; chwc->ptr != NULL; chwc++) {
+      if (fs->mode == FS_LOAD && memcmp(chwc->ptr, fs->buf + fs->pos, chwc->size))
+        fs->carthw_changed = 1;
+      fast_buff(fs, chwc->ptr, chwc->size);
+    }
+  }
+
+  return 0;
+}
+
+size_t PicoStateFastSize(void)
+{
+  struct fast_state fs;
+
+  memset(&fs, 0, sizeof(fs));
+  fs.pos = sizeof(struct fast_hdr);
+  fs.mode = FS_SIZE;
+  fast_state_io(&fs);
+  return fs.pos;
+}
+
+int PicoStateFastSave(void *buf, size_t size)
+{
+  struct fast_state fs;
+  struct fast_hdr hdr;
+
+  if (size < PicoStateFastSize())
+    return -1;
+
+  memset(&fs, 0, sizeof(fs));
+  fs.buf = buf;
+  fs.pos = sizeof(hdr);
+  fs.mode = FS_SAVE;
+  if (fast_state_io(&fs) != 0)
+    return -1;
+
+  memcpy(hdr.magic, "PicoSFST", 8);
+  hdr.ahw = PicoIn.AHW;
+  hdr.size = fs.pos;
+  memcpy(buf, &hdr, sizeof(hdr));
+  return 0;
+}
+
+int PicoStateFastLoad(const void *buf, size_t size)
+{
+  struct fast_state fs;
+  struct fast_hdr hdr;
+  unsigned int ahw = PicoIn.AHW;
+  int flags = PSL_FAST | PSL_MAPS_OK;
+  u8 ms_carthw[16], ms_mapper = 0;
+  u8 cd_r3 = 0, cd_busreq = 0;
+  u16 p32x_bank = 0, p32x_fs = 0;
+  size_t len;
+
+  if (size < sizeof(hdr))
+    return -1;
+  memcpy(&hdr, buf, sizeof(hdr));
+  if (memcmp(hdr.magic, "PicoSFST", 8) || hdr.size > size)
+    return -1;
+
+  // the 32X is the only hardware which may come and go at runtime
+  if ((hdr.ahw ^ ahw) & ~PAHW_32X)
+    return -1;
+  PicoIn.AHW = hdr.ahw;
+  len = PicoStateFastSize();
+  PicoIn.AHW = ahw;
+  if (len != hdr.size) {
+    elprintf(EL_STATUS, "fast state: size mismatch %u/%u", hdr.size, (unsigned)len);
+    return -1;
+  }
+
+#ifndef NO_32X
+  if ((hdr.ahw ^ ahw) & PAHW_32X) {
+    if (hdr.ahw & PAHW_32X)
+      Pico32xStartup();
+    else
+      Pico32xShutdown();
+    flags &= ~PSL_MAPS_OK;
+  }
+  if (PicoIn.AHW & PAHW_32X) {
+    p32x_bank = Pico32x.regs[4 / 2];
+    p32x_fs = Pico32x.vdp_regs[0x0a / 2] & P32XV_FS;
+  }
+#endif
+  if (PicoIn.AHW & PAHW_MCD) {
+    cd_r3 = Pico_mcd->s68k_regs[3];
+    cd_busreq = Pico_mcd->m.busreq;
+  }
+  if (PicoIn.AHW & PAHW_SMS) {
+    ms_mapper = Pico.ms.mapper;
+    memcpy(ms_carthw, Pico.ms.carthw, sizeof(ms_carthw));
+  }
+
+  memset(&fs, 0, sizeof(fs));
+  fs.buf = (u8 *)buf;
+  fs.pos = sizeof(hdr);
+  fs.mode = FS_LOAD;
+  fast_state_io(&fs);
+  PicoVideoLoad(fs.vdp, fs.vdp_len);
+
+#ifndef NO_32X
+  if ((PicoIn.AHW & PAHW_32X) && (p32x_bank != Pico32x.regs[4 / 2] ||
+      p32x_fs != (Pico32x.vdp_regs[0x0a / 2] & P32XV_FS)))
+    flags &= ~PSL_MAPS_OK;
+#endif
+  if ((PicoIn.AHW & PAHW_MCD) && (cd_r3 != Pico_mcd->s68k_regs[3] ||
+      cd_busreq != Pico_mcd->m.busreq))
+    flags &= ~PSL_MAPS_OK;
+  if ((PicoIn.AHW & PAHW_SMS) && (ms_mapper != Pico.ms.mapper ||
+      memcmp(ms_carthw, Pico.ms.carthw, sizeof(ms_carthw))))
+    flags &= ~PSL_MAPS_OK;
+
+  if ((PicoIn.AHW & PAHW_SMS) && !(flags & PSL_MAPS_OK))
+    PicoStateLoadedMS();
+#ifndef NO_32X
+  if (PicoIn.AHW & PAHW_32X)
+    Pico32xMemStateLoaded(flags);
+#endif
+  if (PicoLoadStateHook != NULL && (fs.carthw_changed || !(flags & PSL_MAPS_OK)))
+    PicoLoadStateHook();
+
+  // must unpack 68k and z80 after banks are set up
+  if (!(PicoIn.AHW & PAHW_SMS))
+    SekUnpackCpu(fs.m68k, 0);
+  if (PicoIn.AHW & PAHW_MCD)
+    SekUnpackCpu(fs.s68k, 1);
+  if (fs.z80 != NULL)
+    z80_unpack(fs.z80);
+
+  if (PicoIn.AHW & PAHW_32X)
+    Pico32xStateLoaded(0);
+  if (PicoIn.AHW & PAHW_MCD)
+    pcd_state_loaded(flags);
+  if (!(PicoIn.AHW & PAHW_SMS)) {
+    Pico.video.status &= ~(SR_VB | SR_F);
+    Pico.video.status |= ((Pico.video.reg[1] >> 3) ^ SR_VB) & SR_VB;
+    Pico.video.status |= (Pico.video.pending_ints << 2) & SR_F;
+  }
+
+  Pico.m.dirtyPal = 1;
+  return 0;
+}
+
 int PicoStateLoadGfx(const char *fname)
 {
   void *afile;
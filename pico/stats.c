@@ -0,0 +1,58 @@
+/*
+ * per frame cpu cycle statistics
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+
+#include "pico_int.h"
+
+// stats for the frame in progress, and a ring of the last completed frames
+PicoFrameStats pstats_cur;
+static PicoFrameStats pstats_ring[PSTATS_FRAMES];
+static unsigned int pstats_cnt;
+
+// optional host clock, in us
+unsigned int (*pstats_clock)(void);
+// host time accounted to any cpu so far, to exclude nested cpu runs
+unsigned int pstats_acc;
+
+void PicoStatsSetClock(unsigned int (*get_ticks_us)(void))
+{
+  pstats_clock = get_ticks_us;
+}
+
+void pstats_time(int cpu, unsigned int t0, unsigned int acc0)
+{
+  // time spent in this cpu, minus what nested cpu runs have accounted
+  unsigned int t = pstats_clock() - t0 - (pstats_acc - acc0);
+
+  pstats_cur.cpu[cpu].host_us += t;
+  pstats_acc += t;
+}
+
+void pstats_frame_end(void)
+{
+  pstats_cur.frame = Pico.m.frame_count;
+  pstats_ring[pstats_cnt++ % PSTATS_FRAMES] = pstats_cur;
+  memset(&pstats_cur, 0, sizeof(pstats_cur));
+}
+
+void pstats_reset(void)
+{
+  memset(&pstats_cur, 0, sizeof(pstats_cur));
+  pstats_cnt = 0;
+}
+
+int PicoGetStats(PicoFrameStats *stats, int count)
+{
+  int i, n = pstats_cnt < PSTATS_FRAMES ? pstats_cnt : PSTATS_FRAMES;
+
+  // return the last count frames, oldest first
+  if (count > n)
+    count = n;
+  for (i = 0; i < count; i++)
+    stats[i] = pstats_ring[(pstats_cnt - count + i) % PSTATS_FRAMES];
+
+  return count;
+}
@@ -415,6 +415,13 @@ int PicoVideoFIFOHint(void)
   return burn;
 }
 
+// FIFO empty, no CPU waiting for it and no DMA running?
+int PicoVideoFIFOIdle(void)
+{
+  return !VdpFIFO.fifo_ql && !(Pico.video.status &
+    (SR_DMA|PVS_CPUWR|PVS_CPURD|PVS_DMAFILL|PVS_DMABG|PVS_FIFORUN));
+}
+
 // switch FIFO mode between active/inactive display
 void PicoVideoFIFOMode(int active, int h40)
 {
@@ -527,11 +534,53 @@ static int GetDmaLength(void)
   return len;
 }
 
+// VRAM DMA with increment 2. Copy in runs bounded by the source and the VRAM
+// wrap, and refresh the sprite cache once for the part hitting the SAT.
+static u32 DmaSlowVRAM(u32 a, u16 *base, u32 source, u32 mask, int len)
+{
+  u8 *vr = (u8 *)PicoMem.vram;
+  u32 satlen = ~SATmask + 1;
+
+  while (len > 0)
+  {
+    int n = (0x10001 - (u16)a) >> 1;    // words until VRAM wraps
+    int m = mask+1 - (source & mask);   // words until source wraps
+    u16 *s = base + (source & mask);
+    u32 lo = a & ~1, hi;
+
+    if (n > m) n = m;
+    if (n > len) n = len;
+
+    if (!(a & 1))
+      memcpy(vr + (u16)a, s, n * 2);
+    else {
+      u16 *d = (u16 *)(vr + (u16)lo);
+      int i;
+      for (i = 0; i < n; i++)
+        d[i] = (u16)((s[i] << 8) | (s[i] >> 8));
+    }
+
+    // update sprite cache for the overlapping part, if any
+    hi = lo + n*2;
+    if (lo < SATaddr) lo = SATaddr;
+    if (hi > SATaddr + satlen) hi = SATaddr + satlen;
+    if (lo < hi) {
+      memcpy((u8 *)VdpSATCache + (lo - SATaddr), vr + (u16)lo, hi - lo);
+      Pico.est.rendstatus |= PDRAW_DIRTY_SPRITES;
+    }
+
+    a = (a + n*2) & ~0x20000;
+    source += n;
+    len -= n;
+  }
+  return a;
+}
+
 static void DmaSlow(int len, u32 source)
 {
   struct PicoVideo *pvid=&Pico.video;
   u32 inc = pvid->reg[0xf];
-  u32 a = pvid->addr | (pvid->addr_u << 16), e;
+  u32 a = pvid->addr | (pvid->addr_u << 16);
   u16 *r, *base = NULL;
   u32 mask = 0x1ffff;
   int lc = SekCyclesDone()-Pico.t.m68c_line_start;
@@ -596,15 +645,9 @@ static void DmaSlow(int len, u32 source)
   switch (pvid->type)
   {
     case 1: // vram
-      e = a + len*2-1;
-      r = PicoMem.vram;
-      if (inc == 2 && !(a & 1) && !((a ^ e) >> 16) &&
-          ((a >= SATaddr + 0x280) | (e < SATaddr)) &&
-          !((source ^ (source + len-1)) & ~mask))
-      {
+      if (inc == 2) {
         // most used DMA mode
-        memcpy((char *)r + (u16)a, base + (source & mask), len * 2);
-        a += len * 2;
+        a = DmaSlowVRAM(a, base, source, mask, len);
         break;
       }
       for(; len; len--)
@@ -30,6 +30,8 @@
 
 #include <pico/pico_int.h>
 #include <pico/patch.h>
+#include <pico/debug.h>
+#include <zlib.h>
 
 #if defined(__GNUC__) && __GNUC__ >= 7
 #pragma GCC diagnostic ignored "-Wformat-truncation"
@@ -80,6 +82,9 @@ static char noticeMsg[40];
 
 unsigned char *movie_data = NULL;
 static int movie_size = 0;
+// per frame state hashes while replaying a movie, compare with tools/hashdiff
+static FILE *movie_hash_log;
+static unsigned int movie_hash_snd;
 
 
 /* don't use tolower() for easy old glibc binary compatibility */
@@ -405,6 +410,47 @@ static void do_region_override(const char *media_fname)
 	if (!ret) emu_read_config(NULL, 0);
 }
 
+static void movie_hash_open(void)
+{
+	const char *fname = getenv("PICO_HASH_LOG");
+
+	if (fname == NULL || movie_hash_log != NULL)
+		return;
+	movie_hash_log = fopen(fname, "w");
+	if (movie_hash_log == NULL) {
+		lprintf("failed to open %s\n", fname);
+		return;
+	}
+	fprintf(movie_hash_log, "# frame ram vram cram cpu sound screen\n");
+	movie_hash_snd = 0;
+}
+
+static void movie_hash_close(void)
+{
+	if (movie_hash_log != NULL)
+		fclose(movie_hash_log);
+	movie_hash_log = NULL;
+}
+
+static void movie_hash_frame(int drawn)
+{
+	unsigned int hash[PDH_COUNT], scr = 0;
+	int i, y;
+
+	PDebugStateHash(hash);
+	// screen before any OSD is drawn to it
+	if (drawn)
+		for (y = 0; y < g_screen_height; y++)
+			scr = crc32(scr, (unsigned char *)g_screen_ptr +
+				y * g_screen_ppitch * 2, g_screen_width * 2);
+
+	fprintf(movie_hash_log, "%u", Pico.m.frame_count);
+	for (i = 0; i < PDH_COUNT; i++)
+		fprintf(movie_hash_log, " %08x", hash[i]);
+	fprintf(movie_hash_log, " %08x %08x\n", movie_hash_snd, scr);
+	movie_hash_snd = 0;
+}
+
 int emu_reload_rom(const char *rom_fname_in)
 {
 	// use setting before rom config is loaded
@@ -426,9 +472,11 @@ int emu_reload_rom(const char *rom_fname_in)
 
 	// early cleanup
 	PicoPatchUnload();
+	PicoVgmLogStop();
 	if (movie_data) {
 		free(movie_data);
 		movie_data = 0;
+		movie_hash_close();
 	}
 
 	if (!strcasecmp(ext, ".gmv"))
@@ -537,6 +585,7 @@ int emu_reload_rom(const char *rom_fname_in)
 		}
 		movie_data[0x18+30] = 0;
 		emu_status_msg("MOVIE: %s", (char *) &movie_data[0x18]);
+		movie_hash_open();
 	}
 	else
 	{
@@ -554,6 +603,14 @@ int emu_reload_rom(const char *rom_fname_in)
 	if (currentConfig.EmuOpt & EOPT_EN_SRAM)
 		emu_save_load_game(1, 1);
 
+	// idle loops found in earlier sessions
+	emu_make_path(carthw_path, "idleloops.cfg", sizeof(carthw_path));
+	PicoIdleLoopsLoad(carthw_path);
+
+	// log sound chip writes for offline rendering?
+	if (getenv("PICO_VGM_LOG") != NULL)
+		PicoVgmLogStart(getenv("PICO_VGM_LOG"));
+
 	// state autoload?
 	if (autoload) {
 		int time, newest = 0, newest_slot = -1;
@@ -850,6 +907,7 @@ static void update_movie(void)
 	if (offs+3 > movie_size) {
 		free(movie_data);
 		movie_data = 0;
+		movie_hash_close();
 		emu_status_msg("END OF MOVIE.");
 		lprintf("END OF MOVIE.\n");
 	} else {
@@ -1523,6 +1581,7 @@ void emu_cmn_forced_frame(int no_scale, int do_emu, void *buf)
 
 void emu_init(void)
 {
+	static char cd_index_dir[512];
 	char path[512];
 	int pos;
 
@@ -1547,6 +1606,10 @@ void emu_init(void)
 	mkdir_path(path, pos, "tape");
 	mkdir_path(path, pos, "cfg");
 
+	// CD audio track length indexes go to cfg/
+	snprintf(cd_index_dir, sizeof(cd_index_dir), "%s" PATH_SEP, path);
+	PicoCDIndexDir = cd_index_dir;
+
 	pprof_init();
 
 	make_config_cfg(path);
@@ -1585,6 +1648,8 @@ void emu_finish(void)
 
 static void snd_write_nonblocking(int len)
 {
+	if (movie_hash_log)
+		movie_hash_snd = crc32(movie_hash_snd, (void *)PicoIn.sndOut, len);
 	sndout_write_nb(PicoIn.sndOut, len);
 }
 
@@ -1797,6 +1862,10 @@ void emu_loop(void)
 			diff = timestamp_aim - timestamp;
 		}
 
+		// replays for state hashing must not depend on host speed
+		if (movie_hash_log)
+			skip = 0;
+
 		emu_update_input();
 
 		// 3D glasses
@@ -1809,9 +1878,13 @@ void emu_loop(void)
 			PicoIn.skipFrame = do_audio ? 1 : 2;
 			PicoFrame();
 			PicoIn.skipFrame = 0;
+			if (movie_hash_log)
+				movie_hash_frame(0);
 		}
 		else {
 			PicoFrame();
+			if (movie_hash_log)
+				movie_hash_frame(1);
 			pemu_finalize_frame(fpsbuff, notice_msg);
 			frames_shown++;
 		}
@@ -1856,6 +1929,12 @@ void emu_loop(void)
 		Pico.sv.changed = 0;
 	}
 
+	{
+		char path[512];
+		emu_make_path(path, "idleloops.cfg", sizeof(path));
+		PicoIdleLoopsSave(path);
+	}
+
 	pemu_loop_end();
 	emu_sound_stop();
 	plat_grab_cursor(0);
@@ -17,6 +17,12 @@ static int mp3_file_len, mp3_file_pos;
 static int cdda_out_pos;
 static int decoder_active;
 
+// input read-ahead for the decoders. A mp3 frame is usually less than 1KB,
+// so reading larger chunks saves a seek and read syscall for most frames.
+static FILE *readahead_file;
+static unsigned char readahead_buf[32 * 1024];
+static int readahead_pos, readahead_len;
+
 unsigned short mpeg1_l3_bitrates[16] = {
 	0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320
 };
@@ -77,6 +83,28 @@ out:
 	return retval;
 }
 
+int mp3_read(FILE *f, int pos, unsigned char **data, int size)
+{
+	int avail = readahead_pos + readahead_len - pos;
+
+	if (f != readahead_file || pos < readahead_pos ||
+	    (avail < size && readahead_len == sizeof(readahead_buf)))
+	{
+		fseek(f, pos, SEEK_SET);
+		readahead_len = fread(readahead_buf, 1, sizeof(readahead_buf), f);
+		if (readahead_len < 0)
+			readahead_len = 0;
+		readahead_pos = pos;
+		readahead_file = f;
+		avail = readahead_len;
+	}
+
+	*data = readahead_buf + pos - readahead_pos;
+	if (avail < 0)
+		avail = 0;
+	return avail < size ? avail : size;
+}
+
 void mp3_start_play(void *f_, int pos1024)
 {
 	unsigned char buf[2048];
@@ -87,6 +115,7 @@ void mp3_start_play(void *f_, int pos1024)
 	mp3_current_file = NULL;
 	cdda_out_pos = 0;
 	decoder_active = 0;
+	readahead_file = NULL;
 
 	if (!(PicoIn.opt & POPT_EN_MCD_CDDA) || f == NULL) // cdda disabled or no file?
 		return;
@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 int mp3_find_sync_word(const unsigned char *buf, int size);
+int mp3_read(FILE *f, int pos, unsigned char **data, int size);
 
 /* decoder */
 int mp3dec_start(FILE *f, int fpos_start);
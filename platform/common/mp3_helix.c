@@ -22,7 +22,6 @@ typedef void *HMP3Decoder;
 #endif
 
 static void *mp3dec;
-static unsigned char mp3_input_buffer[2 * 1024];
 
 #ifdef __GP2X__
 #define mp3dec_decode _mp3dec_decode
@@ -36,7 +35,7 @@ int (*p_MP3Decode)(HMP3Decoder, unsigned char **, int *, short *, int);
 
 int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 {
-	unsigned char *readPtr;
+	unsigned char *inputPtr, *readPtr;
 	int bytesLeft;
 	int offset; // mp3 frame offset from readPtr
 	int had_err;
@@ -48,17 +47,16 @@ int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 		if (*file_pos >= file_len)
 			return 1; /* EOF, nothing to do */
 
-		fseek(f, *file_pos, SEEK_SET);
-		bytesLeft = fread(mp3_input_buffer, 1, sizeof(mp3_input_buffer), f);
+		bytesLeft = mp3_read(f, *file_pos, &inputPtr, 2 * 1024);
 
-		offset = mp3_find_sync_word(mp3_input_buffer, bytesLeft);
+		offset = mp3_find_sync_word(inputPtr, bytesLeft);
 		if (offset < 0) {
 			lprintf("find_sync_word (%i/%i) err %i\n",
 				*file_pos, file_len, offset);
 			*file_pos = file_len;
 			return 1; // EOF
 		}
-		readPtr = mp3_input_buffer + offset;
+		readPtr = inputPtr + offset;
 		bytesLeft -= offset;
 
 		had_err = err;
@@ -66,7 +64,7 @@ int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 		if (err) {
 			if (err == ERR_MP3_MAINDATA_UNDERFLOW && !had_err) {
 				// just need another frame
-				*file_pos += readPtr - mp3_input_buffer;
+				*file_pos += readPtr - inputPtr;
 				continue;
 			}
 			if (err == ERR_MP3_INDATA_UNDERFLOW && !had_err) {
@@ -88,7 +86,7 @@ int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 			*file_pos = file_len;
 			return 1;
 		}
-		*file_pos += readPtr - mp3_input_buffer;
+		*file_pos += readPtr - inputPtr;
 	}
 	while (err && --retry > 0);
 
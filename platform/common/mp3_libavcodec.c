@@ -34,7 +34,7 @@ int (*p_avcodec_decode_audio3)(AVCodecContext *avctx, int16_t *samples,
 
 int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 {
-	unsigned char input_buf[2 * 1024];
+	unsigned char *input_buf;
 	int frame_size;
 	AVPacket avpkt;
 	int bytes_in;
@@ -50,8 +50,7 @@ int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 		if (*file_pos >= file_len)
 			return 1; // EOF, nothing to do
 
-		fseek(f, *file_pos, SEEK_SET);
-		bytes_in = fread(input_buf, 1, sizeof(input_buf), f);
+		bytes_in = mp3_read(f, *file_pos, &input_buf, 2 * 1024);
 
 		offset = mp3_find_sync_word(input_buf, bytes_in);
 		if (offset < 0) {
@@ -14,7 +14,6 @@
 #include "mp3.h"
 
 static mp3dec_t mp3dec;
-static unsigned char mp3_input_buffer[2 * 1024];
 
 int mp3dec_start(FILE *f, int fpos_start)
 {
@@ -25,7 +24,7 @@ int mp3dec_start(FILE *f, int fpos_start)
 int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 {
 	mp3dec_frame_info_t info;
-	unsigned char *readPtr;
+	unsigned char *inputPtr, *readPtr;
 	int bytesLeft;
 	int offset; // mp3 frame offset from readPtr
 	int len;
@@ -36,10 +35,9 @@ int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 		if (*file_pos >= file_len)
 			return 1; /* EOF, nothing to do */
 
-		fseek(f, *file_pos, SEEK_SET);
-		bytesLeft = fread(mp3_input_buffer, 1, sizeof(mp3_input_buffer), f);
+		bytesLeft = mp3_read(f, *file_pos, &inputPtr, 2 * 1024);
 
-		offset = mp3_find_sync_word(mp3_input_buffer, bytesLeft);
+		offset = mp3_find_sync_word(inputPtr, bytesLeft);
 		if (offset < 0) {
 			lprintf("find_sync_word (%i/%i) err %i\n",
 				*file_pos, file_len, offset);
@@ -47,7 +45,7 @@ int mp3dec_decode(FILE *f, int *file_pos, int file_len)
 			return 1; // EOF
 		}
 		*file_pos += offset;
-		readPtr = mp3_input_buffer + offset;
+		readPtr = inputPtr + offset;
 		bytesLeft -= offset;
 
 		len = mp3dec_decode_frame(&mp3dec, readPtr, bytesLeft, cdda_out_buffer, &info);
@@ -121,6 +121,19 @@ static int vout_width, vout_height, vout_offset;
 static float vout_aspect = 0.0;
 static int vout_ghosting = 0;
 
+/* XRGB8888 output, in vout_buf32 if there's no frontend framebuffer */
+static int vout_xrgb8888 = 0;
+static uint32_t *vout_buf32;
+static uint32_t vout_pal32[0x100];
+
+/* previous source image, for reporting unchanged frames as dupes. The
+ * 16bit renderers alternate between vout_buf and vout_back_buf, so the last
+ * image is still there. The 8bit CLUT image is copied to vout_prev_buf. */
+static bool vout_can_dupe = false;
+static void *vout_back_buf;
+static unsigned char *vout_prev_buf;
+static int vout_prev_valid = 0, vout_back_swap = 0;
+
 static bool libretro_update_av_info = false;
 static bool libretro_update_geometry = false;
 
@@ -594,6 +607,7 @@ void emu_video_mode_change(int start_line, int line_count, int start_col, int co
    }
 #endif
    Pico.m.dirtyPal = 1;
+   vout_prev_valid = 0;
 
    /* Notify frontend of geometry update */
    libretro_update_geometry = true;
@@ -789,23 +803,37 @@ int state_fseek(void *file, long offset, int whence)
    return (int)state->pos;
 }
 
+/* same instance runahead states never leave this instance, so use the
+ * fixed layout fast states for them. Rollback netplay states are sent
+ * to peers, which may run a different build, so those stay portable */
+static bool state_is_fast(void)
+{
+   int context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &context))
+      return false;
+   return context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE;
+}
+
 /* savestate sizes vary wildly depending if cd/32x or
  * carthw is active, so run the whole thing to get size */
 size_t retro_serialize_size(void)
 {
    struct savestate_state state = { 0, };
    unsigned AHW = PicoIn.AHW;
+   size_t fast_size;
    int ret;
 
    /* we need the max possible size here, so include 32X for MD and MCD */
    if (!(AHW & (PAHW_SMS|PAHW_PICO|PAHW_SVP)))
       PicoIn.AHW |= PAHW_32X;
    ret = PicoStateFP(&state, 1, NULL, state_skip, NULL, state_fseek);
+   fast_size = PicoStateFastSize();
    PicoIn.AHW = AHW;
    if (ret != 0)
       return 0;
 
-   return state.pos;
+   return state.pos > fast_size ? state.pos : fast_size;
 }
 
 bool retro_serialize(void *data, size_t size)
@@ -813,6 +841,9 @@ bool retro_serialize(void *data, size_t size)
    struct savestate_state state = { 0, };
    int ret;
 
+   if (state_is_fast())
+      return PicoStateFastSave(data, size) == 0;
+
    state.save_buf = data;
    state.size = size;
    state.pos = 0;
@@ -827,6 +858,12 @@ bool retro_unserialize(const void *data, size_t size)
    struct savestate_state state = { 0, };
    int ret;
 
+   /* the frame after a state load can't be a dupe of the last one shown */
+   vout_prev_valid = 0;
+
+   if (PicoStateFastLoad(data, size) == 0)
+      return true;
+
    state.load_buf = data;
    state.size = size;
    state.pos = 0;
@@ -1270,6 +1307,8 @@ static const char * const biosfiles_jp[] = {
    "jp_mcd2_921222", "jp_mcd1_9112", "jp_mcd1_9111", "bios_CD_J"
 };
 
+static char idleloops_path[PATH_MAX];
+
 static void make_system_path(char *buf, size_t buf_size,
    const char *name, const char *ext)
 {
@@ -1543,7 +1582,19 @@ bool retro_load_game(const struct retro_game_info *info)
    }
 
    enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt)) {
+   vout_xrgb8888 = 0;
+#if !defined(RENDER_GSKIT_PS2)
+   struct retro_variable var = { .key = "picodrive_pixel_format" };
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value &&
+       strcmp(var.value, "xrgb8888") == 0) {
+      fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+      if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+         vout_xrgb8888 = 1;
+      else
+         fmt = RETRO_PIXEL_FORMAT_RGB565;
+   }
+#endif
+   if (!vout_xrgb8888 && !environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt)) {
       if (log_cb)
          log_cb(RETRO_LOG_ERROR, "RGB565 support required, sorry\n");
       return false;
@@ -1598,6 +1649,18 @@ bool retro_load_game(const struct retro_game_info *info)
 
    make_system_path(carthw_path, sizeof(carthw_path), "carthw", ".cfg");
 
+   /* CD audio track length indexes go to the save directory, if any */
+   {
+      static char cd_index_dir[PATH_MAX];
+      const char *dir = NULL;
+
+      PicoCDIndexDir = NULL;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) && dir && *dir) {
+         snprintf(cd_index_dir, sizeof(cd_index_dir), "%s%c", dir, SLASH);
+         PicoCDIndexDir = cd_index_dir;
+      }
+   }
+
    media_type = PicoLoadMedia(content_path, content_data, content_size,
          carthw_path, find_bios, find_msu, NULL);
 
@@ -1624,6 +1687,10 @@ bool retro_load_game(const struct retro_game_info *info)
       break;
    }
 
+   /* idle loops found in earlier sessions */
+   make_system_path(idleloops_path, sizeof(idleloops_path), "idleloops", ".cfg");
+   PicoIdleLoopsLoad(idleloops_path);
+
    strncpy(pico_overlay_path, content_path, sizeof(pico_overlay_path)-4);
    if (PicoIn.AHW & PAHW_PICO)
       environ_cb(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, desc_pico);
@@ -1667,6 +1734,9 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info *i
 
 void retro_unload_game(void)
 {
+   if (idleloops_path[0])
+      PicoIdleLoopsSave(idleloops_path);
+   idleloops_path[0] = '\0';
 }
 
 unsigned retro_get_region(void)
@@ -2008,6 +2078,13 @@ static void update_variables(bool first_run)
       mix_reset (PicoIn.opt & POPT_EN_SNDFILTER ? PicoIn.sndFilterAlpha : 0);
    }
 
+   /* hand audio over every n lines, lets the frontend keep its buffer small */
+   var.value = NULL;
+   var.key = "picodrive_audio_chunk";
+   PicoIn.sndChunkLines = 0;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      PicoIn.sndChunkLines = atoi(var.value);
+
    old_frameskip_type = frameskip_type;
    frameskip_type     = 0;
    var.key            = "picodrive_frameskip";
@@ -2318,11 +2395,162 @@ void run_events_pico(unsigned int events)
     PicoPicohw.pen_pos[1] |= (pico_inp_mode == 1 ? 0x2f8 : 0x1fc) + pico_pen_y;
 }
 
+#if !defined(RENDER_GSKIT_PS2)
+static inline uint32_t vout_rgb565_to_xrgb8888(unsigned short p)
+{
+   uint32_t r = p >> 11, g = (p >> 5) & 0x3f, b = p & 0x1f;
+   return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+/* Compare the source image with the one of the last frame */
+static int vout_dupe_check(void)
+{
+   unsigned char *ps;
+   int len;
+
+   /* ghosting and the pico overlay change the output by themselves */
+   if (!vout_can_dupe || (vout_ghosting && vout_height == 144) ||
+       (PicoIn.AHW & PAHW_PICO))
+      return 0;
+
+   if (vout_16bit) {
+      if (!vout_back_buf) {
+#ifdef _3DS
+         vout_back_buf = linearMemAlign(VOUT_MAX_WIDTH * VOUT_MAX_HEIGHT * 2, 0x80);
+#else
+         vout_back_buf = malloc(VOUT_MAX_WIDTH * VOUT_MAX_HEIGHT * 2);
+#endif
+         if (!vout_back_buf)
+            return 0;
+         memset(vout_back_buf, 0, VOUT_MAX_WIDTH * VOUT_MAX_HEIGHT * 2);
+         vout_prev_valid = 0;
+      }
+
+      len = vout_width * vout_height * 2;
+      if (vout_prev_valid && memcmp((char *)vout_back_buf + vout_offset,
+                                    (char *)vout_buf + vout_offset, len) == 0)
+         return 1;
+      /* render the next frame to the other buffer once this one is out */
+      vout_back_swap = 1;
+      vout_prev_valid = 1;
+      return 0;
+   }
+
+   if (!vout_prev_buf) {
+      vout_prev_buf = malloc(VOUT_MAX_HEIGHT * 328 + sizeof(Pico.est.HighPal));
+      if (!vout_prev_buf)
+         return 0;
+   }
+
+   /* CLUT image lines and the palette */
+   ps = Pico.est.Draw2FB + vm_current_start_line * 328;
+   len = vout_height * 328;
+   if (vout_prev_valid &&
+       memcmp(vout_prev_buf + len, Pico.est.HighPal, sizeof(Pico.est.HighPal)))
+      vout_prev_valid = 0;
+   memcpy(vout_prev_buf + len, Pico.est.HighPal, sizeof(Pico.est.HighPal));
+
+   if (vout_prev_valid && memcmp(vout_prev_buf, ps, len) == 0)
+      return 1;
+   memcpy(vout_prev_buf, ps, len);
+   vout_prev_valid = 1;
+   return 0;
+}
+
+/* Exchange vout_buf and vout_back_buf after a frame has been output */
+static void vout_swap_bufs(void)
+{
+   void *tmp = vout_buf;
+
+   vout_buf = vout_back_buf;
+   vout_back_buf = tmp;
+   vout_back_swap = 0;
+   PicoDrawSetOutBuf(vout_buf, vout_width * 2);
+}
+
+/* Output buffer for a conversion pass, the frontend framebuffer if possible */
+static void *vout_get_out_buf(size_t *pitch)
+{
+   struct retro_framebuffer fb = { 0 };
+
+   fb.width = vout_width;
+   fb.height = vout_height;
+   fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) &&
+       fb.data && fb.width == vout_width && fb.height == vout_height &&
+       fb.format == (vout_xrgb8888 ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565)) {
+      *pitch = fb.pitch;
+      return fb.data;
+   }
+
+   if (!vout_xrgb8888) {
+      *pitch = vout_width * 2;
+      return (char*)vout_buf + vout_offset;
+   }
+   if (!vout_buf32) {
+      vout_buf32 = malloc(VOUT_MAX_WIDTH * VOUT_MAX_HEIGHT * 4);
+      if (!vout_buf32)
+         return NULL;
+   }
+   *pitch = vout_width * 4;
+   return vout_buf32;
+}
+
+/* Apply the CLUT to the 8 bit renderer image */
+static void vout_expand_clut(void *dst, size_t pitch, int xrgb8888)
+{
+   /* Skip the leftmost 8 columns (it is used as an overlap area for rendering) */
+   unsigned char *ps = Pico.est.Draw2FB + vm_current_start_line * 328 + 8;
+   unsigned short *pal = Pico.est.HighPal;
+   int x, y;
+
+   /* 8 bit renderers have an extra offset for SMS with 1st tile blanked */
+   if (vout_width == 248)
+      ps += 8;
+
+   if (xrgb8888) {
+      for (x = 0; x < 0x100; x++)
+         vout_pal32[x] = vout_rgb565_to_xrgb8888(pal[x]);
+      for (y = 0; y < vout_height; y++, ps += 328) {
+         uint32_t *pd = (uint32_t *)((char *)dst + y * pitch);
+         for (x = 0; x < vout_width; x+=4) {
+            *pd++ = vout_pal32[ps[x+0]];
+            *pd++ = vout_pal32[ps[x+1]];
+            *pd++ = vout_pal32[ps[x+2]];
+            *pd++ = vout_pal32[ps[x+3]];
+         }
+      }
+   } else {
+      for (y = 0; y < vout_height; y++, ps += 328) {
+         unsigned short *pd = (unsigned short *)((char *)dst + y * pitch);
+         for (x = 0; x < vout_width; x+=4) {
+            *pd++ = pal[ps[x+0]];
+            *pd++ = pal[ps[x+1]];
+            *pd++ = pal[ps[x+2]];
+            *pd++ = pal[ps[x+3]];
+         }
+      }
+   }
+}
+
+static void vout_convert_xrgb8888(void *dst, size_t pitch, unsigned short *ps)
+{
+   int x, y;
+
+   for (y = 0; y < vout_height; y++, ps += vout_width) {
+      uint32_t *pd = (uint32_t *)((char *)dst + y * pitch);
+      for (x = 0; x < vout_width; x++)
+         pd[x] = vout_rgb565_to_xrgb8888(ps[x]);
+   }
+}
+#endif
+
 void retro_run(void)
 {
    bool updated = false;
    int pad, i, padcount;
    static void *buff;
+   size_t pitch = vout_width * 2;
 
    PicoIn.skipFrame = 0;
 
@@ -2426,7 +2654,7 @@ void retro_run(void)
    /* If frame was skipped, call video_cb() with
     * a NULL buffer and return immediately */
    if (PicoIn.skipFrame) {
-      video_cb(NULL, vout_width, vout_height, vout_width * 2);
+      video_cb(NULL, vout_width, vout_height, vout_width * (vout_xrgb8888 ? 4 : 2));
       return;
    }
 
@@ -2473,34 +2701,44 @@ void retro_run(void)
       }
    }
 #else
-   if (!vout_16bit) {
-      /* The 8 bit renderers write a CLUT image in Pico.est.Draw2FB, while libretro wants RGB in vout_buf.
-       * We need to manually copy that to vout_buf, applying the CLUT on the way. Especially
-       * with the fast renderer this is improving performance, at the expense of accuracy.
-       */
-      /* This section is mostly copied from pemu_finalize_frame in platform/linux/emu.c */
-      unsigned short *pd = (unsigned short *)((char *)vout_buf + vout_offset);
-      /* Skip the leftmost 8 columns (it is used as an overlap area for rendering) */
-      unsigned char *ps = Pico.est.Draw2FB + vm_current_start_line * 328 + 8;
-      unsigned short *pal = Pico.est.HighPal;
-      int x;
-      if (Pico.m.dirtyPal)
-         PicoDrawUpdateHighPal();
-      /* 8 bit renderers have an extra offset for SMS wíth 1st tile blanked */
-      if (vout_width == 248)
-         ps += 8;
-      /* Copy, and skip the leftmost 8 columns again */
-      for (i = 0; i < vout_height; i++, ps += 8) {
-         for (x = 0; x < vout_width; x+=4) {
-            *pd++ = pal[*ps++];
-            *pd++ = pal[*ps++];
-            *pd++ = pal[*ps++];
-            *pd++ = pal[*ps++];
-         }
-         ps += 320-vout_width; /* Advance to next line in case of 32col mode */
+   int direct, av_enable = 3;
+
+   if (!vout_16bit && Pico.m.dirtyPal)
+      PicoDrawUpdateHighPal();
+
+   /* Nothing to do if the image hasn't changed since the last frame. Frames
+    * the frontend discards anyway (e.g. runahead) don't count as shown */
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &av_enable))
+      av_enable = 3;
+   if ((av_enable & 1) && vout_dupe_check()) {
+      video_cb(NULL, vout_width, vout_height, vout_width * (vout_xrgb8888 ? 4 : 2));
+      return;
+   }
+
+   /* The 8 bit renderers write a CLUT image in Pico.est.Draw2FB, while libretro
+    * wants RGB. If there is no post processing the CLUT is applied on the way to
+    * the output buffer, else the image goes to vout_buf first.
+    */
+   direct = !vout_16bit && !(vout_ghosting && vout_height == 144) &&
+            !(PicoIn.AHW & PAHW_PICO);
+   pitch = vout_width * 2;
+   buff = (char*)vout_buf + vout_offset;
+   if (direct || vout_xrgb8888) {
+      buff = vout_get_out_buf(&pitch);
+      if (!buff) {
+         vout_prev_valid = vout_back_swap = 0;
+         video_cb(NULL, vout_width, vout_height, vout_width * (vout_xrgb8888 ? 4 : 2));
+         return;
       }
    }
 
+   if (!vout_16bit) {
+      if (direct)
+         vout_expand_clut(buff, pitch, vout_xrgb8888);
+      else
+         vout_expand_clut((char*)vout_buf + vout_offset, vout_width * 2, 0);
+   }
+
    if (vout_ghosting && vout_height == 144) {
       unsigned short *pd = (unsigned short *)vout_buf;
       unsigned short *ps = (unsigned short *)vout_ghosting_buf;
@@ -2525,10 +2763,16 @@ void retro_run(void)
          draw_pico_ptr();
    }
 
-   buff = (char*)vout_buf + vout_offset;
+   if (vout_xrgb8888 && !direct)
+      vout_convert_xrgb8888(buff, pitch,
+         (unsigned short *)((char *)vout_buf + vout_offset));
 #endif
 
-   video_cb((short *)buff, vout_width, vout_height, vout_width * 2);
+   video_cb((short *)buff, vout_width, vout_height, pitch);
+#if !defined(RENDER_GSKIT_PS2)
+   if (vout_back_swap)
+      vout_swap_bufs();
+#endif
 }
 
 void retro_init(void)
@@ -2550,6 +2794,9 @@ void retro_init(void)
    if (environ_cb(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, NULL))
       libretro_supports_bitmasks = true;
 
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &vout_can_dupe))
+      vout_can_dupe = false;
+
    disk_initial_index = 0;
    disk_initial_path[0] = '\0';
    if (environ_cb(RETRO_ENVIRONMENT_GET_DISK_CONTROL_INTERFACE_VERSION, &dci_version) && (dci_version >= 1))
@@ -2639,6 +2886,17 @@ void retro_deinit(void)
    if (vout_ghosting_buf)
       free(vout_ghosting_buf);
    vout_ghosting_buf = NULL;
+   free(vout_buf32);
+   vout_buf32 = NULL;
+#ifdef _3DS
+   linearFree(vout_back_buf);
+#else
+   free(vout_back_buf);
+#endif
+   vout_back_buf = NULL;
+   free(vout_prev_buf);
+   vout_prev_buf = NULL;
+   vout_prev_valid = 0;
    if (pico_overlay)
       free(pico_overlay);
    pico_overlay = NULL;
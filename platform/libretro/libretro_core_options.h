@@ -218,6 +218,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "accurate"
    },
+   {
+      "picodrive_pixel_format",
+      "Output Pixel Format",
+      NULL,
+      "Pixel format of the video output. XRGB8888 avoids a conversion in frontends using it natively. Requires restart.",
+      NULL,
+      "video",
+      {
+         { "rgb565",   "RGB565" },
+         { "xrgb8888", "XRGB8888" },
+         { NULL, NULL },
+      },
+      "rgb565"
+   },
    {
       "picodrive_sound_rate",
       "Audio Sample Rate (Hz)",
@@ -322,6 +336,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "60"
    },
+   {
+      "picodrive_audio_chunk",
+      "Audio Chunk Size (lines)",
+      NULL,
+      "Deliver audio to the frontend every N scanlines instead of once per frame. Frontends monitoring their audio buffer can then run with lower audio latency. Smaller chunks cost a little performance.",
+      NULL,
+      "audio",
+      {
+         { "disabled", NULL },
+         { "16",  NULL },
+         { "32",  NULL },
+         { "64",  NULL },
+         { "128", NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       "picodrive_input1",
       "Input Device 1",
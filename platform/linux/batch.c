@@ -0,0 +1,429 @@
+/*
+ * PicoDrive
+ * headless batch runner for regression and performance runs
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ *
+ * usage: picobatch [-j jobs] [-n frames] [-c carthw.cfg] [-b cd_bios]
+ *                  [-o report] [-s] [-e] [-t] <list>
+ *
+ * Each line in the list file is "rom [frames [input]]", # starts a comment.
+ * An input file has "frame pad0 [pad1]" lines with the pad bits in hex
+ * (MXYZ SACB RLDU), each line is held until the frame in the next one.
+ * Every title is run in a fresh process, up to jobs of them in parallel.
+ * With -s a fast state is saved and loaded back after every frame, as rollback
+ * netplay would do, and the time taken is reported.
+ * With -e every title is run a 2nd time with idle line merging disabled, and
+ * the first frame where the state or screen hashes of both runs differ is
+ * reported, or "same" if there is none.
+ * With -t it's the same, but the 2nd run is without SH2 DRC superblocks, which
+ * compares the fps of both runs per title.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <zlib.h>
+
+#include <pico/pico_int.h>
+#include <pico/debug.h>
+#include "headless.h"
+
+enum { RES_NONE, RES_OK, RES_LOAD_FAIL, RES_CRASH };
+
+struct title {
+	char rom[256];
+	char input[256];
+	int frames;
+	int hash_offs; // into frame_hash, for -e/-t
+};
+
+struct result {
+	int status;
+	int frames;
+	double secs;
+	double peak_ms;
+	unsigned int hash[PDH_COUNT];
+	unsigned int snd, scr;
+	double slices, slice_cycles, resyncs, resync_us; // 32X sh2 sync, all frames
+	double state_ms, state_peak_ms; // fast state save+load, all frames
+};
+
+static struct title *titles;
+static struct result *results;
+static int title_count;
+
+static const char *carthw_cfg = "carthw.cfg";
+static const char *cd_bios;
+static int state_bench;
+static int equiv_check;
+static int equiv_opt; // POPT_* for the 2nd run with -e/-t
+static const char *equiv_name;
+static unsigned int *frame_hash; // per frame state+screen hash, for -e/-t
+static short ALIGNED(4) snd_buf[2*54000/50];
+static unsigned int snd_crc;
+
+static const char *find_bios(int *region, const char *cd_fname)
+{
+	return cd_bios;
+}
+
+static void snd_write(int len)
+{
+	snd_crc = crc32(snd_crc, (void *)PicoIn.sndOut, len);
+}
+
+static unsigned int ticks_us(void)
+{
+	return (unsigned long long)(hl_time() * 1000000);
+}
+
+static void sync_add(struct result *r)
+{
+	PicoFrameStats fs;
+
+	if (PicoGetStats(&fs, 1) != 1)
+		return;
+	r->slices += fs.sync.slices;
+	r->slice_cycles += fs.sync.slice_cycles;
+	r->resyncs += fs.sync.resyncs;
+	r->resync_us += fs.sync.resync_us;
+}
+
+/* per title worker */
+
+static void state_roundtrip(struct result *r, void *buf, size_t size)
+{
+	double t0 = hl_time(), ms;
+
+	if (PicoStateFastSave(buf, size) != 0 || PicoStateFastLoad(buf, size) != 0) {
+		fprintf(stderr, "fast state failed\n");
+		return;
+	}
+	ms = (hl_time() - t0) * 1000;
+	r->state_ms += ms;
+	if (ms > r->state_peak_ms)
+		r->state_peak_ms = ms;
+}
+
+static void input_next(FILE *f, int *frame, int *pad)
+{
+	char buff[128];
+
+	*frame = -1;
+	while (f != NULL && fgets(buff, sizeof(buff), f) != NULL) {
+		pad[0] = pad[1] = 0;
+		if (buff[0] != '#' && sscanf(buff, "%d %x %x", frame, &pad[0], &pad[1]) >= 2)
+			return;
+		*frame = -1;
+	}
+}
+
+static unsigned int frame_state_hash(void)
+{
+	unsigned int hash[PDH_COUNT];
+
+	PDebugStateHash(hash);
+	return crc32(crc32(0, (void *)hash, sizeof(hash)),
+		(void *)hl_screen, sizeof(hl_screen));
+}
+
+static void run_title(struct title *t, struct result *r, unsigned int *fh,
+	int opt2)
+{
+	int pad[2], next_pad[2] = { 0, 0 }, next_frame;
+	enum media_type_e media_type;
+	double t0, tf, ms;
+	FILE *input = NULL;
+	void *state = NULL;
+	size_t state_size = 0;
+	int i;
+
+	PicoIn.opt = POPT_EN_STEREO|POPT_EN_FM|POPT_EN_PSG|POPT_EN_Z80
+		| POPT_EN_MCD_PCM|POPT_EN_MCD_CDDA|POPT_EN_MCD_GFX
+		| POPT_EN_32X|POPT_EN_PWM|POPT_ACC_SPRITES|POPT_DIS_32C_BORDER;
+#ifdef DRC_SH2
+	PicoIn.opt |= POPT_EN_DRC;
+#endif
+	if (opt2)
+		PicoIn.opt |= equiv_opt;
+	PicoIn.sndRate = 44100;
+	PicoIn.autoRgnOrder = 0x184; // US, EU, JP
+	PicoInit();
+
+	media_type = PicoLoadMedia(t->rom, NULL, 0, carthw_cfg, find_bios, NULL, NULL);
+	if (media_type < 0) {
+		r->status = RES_LOAD_FAIL;
+		return;
+	}
+
+	PicoLoopPrepare();
+	PicoIn.writeSound = snd_write;
+	PicoIn.sndOut = snd_buf;
+	PsndRerate(0);
+	PicoDrawSetOutFormat(PDF_RGB555, 0);
+	PicoDrawSetOutBuf(hl_screen, HL_W * 2);
+	PicoIn.skipFrame = 0;
+	PicoStatsSetClock(ticks_us);
+
+	if (t->input[0] != 0 && (input = fopen(t->input, "r")) == NULL)
+		fprintf(stderr, "%s: can't open %s\n", t->rom, t->input);
+	pad[0] = pad[1] = 0;
+	input_next(input, &next_frame, next_pad);
+
+	t0 = hl_time();
+	for (i = 0; i < t->frames; i++) {
+		while (next_frame >= 0 && next_frame <= i) {
+			pad[0] = next_pad[0], pad[1] = next_pad[1];
+			input_next(input, &next_frame, next_pad);
+		}
+		PicoIn.pad[0] = pad[0];
+		PicoIn.pad[1] = pad[1];
+
+		tf = hl_time();
+		PicoFrame();
+		ms = (hl_time() - tf) * 1000;
+		if (ms > r->peak_ms)
+			r->peak_ms = ms;
+		sync_add(r);
+
+		r->scr = crc32(r->scr, (void *)hl_screen, sizeof(hl_screen));
+		if (fh != NULL)
+			fh[i] = frame_state_hash();
+
+		if (state_bench) {
+			// the size changes if the 32X is enabled later
+			if (state_size < PicoStateFastSize()) {
+				state_size = PicoStateFastSize();
+				free(state);
+				state = malloc(state_size);
+			}
+			if (state != NULL)
+				state_roundtrip(r, state, state_size);
+		}
+	}
+	r->secs = hl_time() - t0;
+	r->frames = i;
+	r->snd = snd_crc;
+	PDebugStateHash(r->hash);
+	r->status = RES_OK;
+
+	if (input != NULL)
+		fclose(input);
+	free(state);
+	PicoExit();
+}
+
+/* driver */
+
+static int load_list(const char *fname, int frames)
+{
+	char buff[640], rom[256], input[256];
+	int alloc = 0, n, f;
+	FILE *list;
+
+	list = fopen(fname, "r");
+	if (list == NULL)
+		return -1;
+
+	while (fgets(buff, sizeof(buff), list) != NULL) {
+		if (buff[0] == '#')
+			continue;
+		input[0] = 0;
+		f = frames;
+		n = sscanf(buff, "%255s %d %255s", rom, &f, input);
+		if (n < 1)
+			continue;
+
+		if (title_count >= alloc) {
+			alloc = alloc * 2 + 64;
+			titles = realloc(titles, alloc * sizeof(*titles));
+			if (titles == NULL)
+				break;
+		}
+		strcpy(titles[title_count].rom, rom);
+		strcpy(titles[title_count].input, n >= 3 ? input : "");
+		titles[title_count].frames = f;
+		title_count++;
+	}
+
+	fclose(list);
+	return titles == NULL ? -1 : 0;
+}
+
+// compare the runs with and without equiv_opt frame by frame
+static void report_equiv(FILE *f)
+{
+	int i, j, n, diff = 0;
+
+	fprintf(f, "# title fps fps_no_%s first_differing_frame\n", equiv_name);
+	for (i = 0; i < title_count; i++) {
+		struct result *r = &results[i], *rn = &results[title_count + i];
+		unsigned int *h = frame_hash + 2*titles[i].hash_offs;
+
+		n = r->frames < rn->frames ? r->frames : rn->frames;
+		for (j = 0; j < n; j++)
+			if (h[j] != h[titles[i].frames + j])
+				break;
+		fprintf(f, "%s %.1f %.1f ", titles[i].rom,
+			r->secs > 0 ? r->frames / r->secs : 0,
+			rn->secs > 0 ? rn->frames / rn->secs : 0);
+		if (r->status != RES_OK || rn->status != RES_OK)
+			fprintf(f, "failed\n");
+		else if (j < n || r->frames != rn->frames)
+			fprintf(f, "%d\n", j), diff++;
+		else
+			fprintf(f, "same\n");
+	}
+	fprintf(f, "# %d titles differ without %s\n", diff, equiv_name);
+}
+
+static void report(FILE *f, double wall)
+{
+	static const char *status[] = { "not_run", "ok", "load_fail", "crash" };
+	int i, failed = 0;
+	long frames = 0;
+
+	fprintf(f, "# title frames fps peak_ms ram vram cram cpu sound screen status"
+		" [state avg_ms/peak_ms] [syncs/frame avg_slice resyncs/frame resync_ms]\n");
+	for (i = 0; i < title_count; i++) {
+		struct result *r = &results[i];
+		fprintf(f, "%s %d %.1f %.2f %08x %08x %08x %08x %08x %08x %s",
+			titles[i].rom, r->frames, r->secs > 0 ? r->frames / r->secs : 0,
+			r->peak_ms, r->hash[PDH_RAM], r->hash[PDH_VRAM],
+			r->hash[PDH_CRAM], r->hash[PDH_CPU], r->snd, r->scr,
+			status[r->status]);
+		if (state_bench && r->frames)
+			fprintf(f, " state %.3f/%.3f", r->state_ms / r->frames,
+				r->state_peak_ms);
+		// sync stats, only for titles using the 32X
+		if (r->slices > 0 && r->frames)
+			fprintf(f, " %.1f %.1f %.1f %.2f", r->slices / r->frames,
+				r->slice_cycles / r->slices, r->resyncs / r->frames,
+				r->resync_us / 1000);
+		fprintf(f, "\n");
+		if (r->status != RES_OK)
+			failed++;
+		frames += r->frames;
+	}
+	if (equiv_check)
+		report_equiv(f);
+	fprintf(f, "# %d titles, %d failed, %ld frames in %.1fs (%.1f fps overall)\n",
+		title_count, failed, frames, wall, wall > 0 ? frames / wall : 0);
+}
+
+static void usage(const char *argv0)
+{
+	printf("usage: %s [-j jobs] [-n frames] [-c carthw.cfg] [-b cd_bios]\n"
+	       "       %*s [-o report] [-s] [-e] [-t] [-v] <list>\n", argv0, (int)strlen(argv0), "");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int frames = 60*60;
+	const char *out_name = NULL;
+	FILE *out = stdout;
+	pid_t *pids, pid;
+	int i, c, runs, running = 0, next = 0, status;
+	long hash_count = 0;
+	double t0;
+
+	while ((c = getopt(argc, argv, "j:n:c:b:o:setv")) != -1) {
+		switch (c) {
+		case 'j': jobs = atoi(optarg); break;
+		case 'n': frames = atoi(optarg); break;
+		case 'c': carthw_cfg = optarg; break;
+		case 'b': cd_bios = optarg; break;
+		case 'o': out_name = optarg; break;
+		case 's': state_bench = 1; break;
+		case 'e': equiv_check = 1;
+			  equiv_opt = POPT_DIS_LINE_MERGE, equiv_name = "merge"; break;
+		case 't': equiv_check = 1;
+			  equiv_opt = POPT_DIS_SH2_TRACE, equiv_name = "trace"; break;
+		case 'v': hl_verbose = 1; break;
+		default:  usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+	if (jobs < 1)
+		jobs = 1;
+
+	if (load_list(argv[optind], frames) != 0 || title_count == 0) {
+		fprintf(stderr, "can't read titles from %s\n", argv[optind]);
+		return 1;
+	}
+
+	// with -e/-t the 2nd half of the runs is with equiv_opt
+	runs = equiv_check ? 2*title_count : title_count;
+	for (i = 0; i < title_count; i++) {
+		titles[i].hash_offs = hash_count;
+		hash_count += titles[i].frames;
+	}
+
+	// results are written by the workers directly into shared memory
+	results = mmap(NULL, runs * sizeof(*results), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (equiv_check)
+		frame_hash = mmap(NULL, 2 * hash_count * sizeof(*frame_hash),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	pids = calloc(runs, sizeof(*pids));
+	if (results == MAP_FAILED || frame_hash == MAP_FAILED || pids == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	memset(results, 0, runs * sizeof(*results));
+
+	t0 = hl_time();
+	while (next < runs || running > 0) {
+		if (next < runs && running < jobs) {
+			pids[next] = fork();
+			if (pids[next] == 0) {
+				struct title *t = &titles[next % title_count];
+				int opt2 = next >= title_count;
+				unsigned int *fh = NULL;
+				if (frame_hash != NULL)
+					fh = frame_hash + 2*t->hash_offs + opt2*t->frames;
+				run_title(t, &results[next], fh, opt2);
+				_exit(0);
+			}
+			if (pids[next] > 0)
+				running++;
+			next++;
+			continue;
+		}
+
+		pid = wait(&status);
+		if (pid < 0)
+			break;
+		running--;
+		for (i = 0; i < next; i++) {
+			if (pids[i] != pid)
+				continue;
+			if (results[i].status == RES_NONE || !WIFEXITED(status))
+				results[i].status = RES_CRASH;
+			if (hl_verbose)
+				fprintf(stderr, "%s done\n", titles[i % title_count].rom);
+			break;
+		}
+	}
+
+	if (out_name != NULL && (out = fopen(out_name, "w")) == NULL) {
+		fprintf(stderr, "can't write %s\n", out_name);
+		out = stdout;
+	}
+	report(out, hl_time() - t0);
+	if (out != stdout)
+		fclose(out);
+
+	for (i = 0; i < runs; i++)
+		if (results[i].status != RES_OK)
+			return 2;
+	return 0;
+}
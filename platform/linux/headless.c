@@ -0,0 +1,91 @@
+/*
+ * PicoDrive
+ * platform hooks for headless tools running the core without a frontend
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ */
+
+#define _GNU_SOURCE // mremap
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include <pico/pico_int.h>
+#include "headless.h"
+
+int hl_verbose;
+unsigned short hl_screen[HL_W * HL_H];
+
+double hl_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void lprintf(const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!hl_verbose)
+		return;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+void cache_flush_d_inval_i(void *start, void *end)
+{
+	__builtin___clear_cache(start, end);
+}
+
+void *plat_mmap(unsigned long addr, size_t size, int need_exec, int is_fixed)
+{
+	void *ret = mmap((void *)addr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ret == MAP_FAILED)
+		return NULL;
+	if (addr != 0 && ret != (void *)addr && is_fixed) {
+		munmap(ret, size);
+		return NULL;
+	}
+	return ret;
+}
+
+void *plat_mremap(void *ptr, size_t oldsize, size_t newsize)
+{
+	void *ret = mremap(ptr, oldsize, newsize, 0);
+	return ret == MAP_FAILED ? NULL : ret;
+}
+
+void plat_munmap(void *ptr, size_t size)
+{
+	if (ptr != NULL)
+		munmap(ptr, size);
+}
+
+void *plat_mem_get_for_drc(size_t size)
+{
+	return NULL;
+}
+
+int plat_mem_set_exec(void *ptr, size_t size)
+{
+	return mprotect(ptr, size, PROT_READ | PROT_WRITE | PROT_EXEC);
+}
+
+void emu_video_mode_change(int start_line, int line_count, int start_col, int col_count)
+{
+	memset(hl_screen, 0, sizeof(hl_screen));
+	Pico.m.dirtyPal = 1;
+}
+
+void emu_32x_startup(void)
+{
+	PicoDrawSetOutFormat(PDF_RGB555, 0);
+	PicoDrawSetOutBuf(hl_screen, HL_W * 2);
+}
@@ -0,0 +1,9 @@
+// shared by the headless tools, see headless.c
+
+#define HL_W 320
+#define HL_H 240
+
+extern int hl_verbose;                     // lprintf goes to stderr if set
+extern unsigned short hl_screen[HL_W * HL_H]; // 16bit output buffer
+
+double hl_time(void);                      // monotonic time in seconds
@@ -0,0 +1,200 @@
+/*
+ * PicoDrive
+ * offline vgm renderer, runs logged sound chip streams through the sound
+ * cores as fast as possible, for benchmarking and comparing sound options
+ *
+ * This work is licensed under the terms of MAME license.
+ * See COPYING file in the top-level directory.
+ *
+ * usage: picovgm [-r rate] [-m] [-f] [-y] [-s] [-l seconds]
+ *                [-o out.wav] [-c ref.wav] <file.vgm>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <zlib.h>
+
+#include <pico/pico_int.h>
+#include <pico/sound/vgm.h>
+#include "headless.h"
+
+static short ALIGNED(4) snd_buf[2*54000/50];
+static FILE *wav_out, *wav_ref;
+static unsigned int snd_crc, data_bytes;
+
+// comparison with the reference
+static unsigned int cmp_samples, cmp_missing;
+static int cmp_max;
+static double cmp_sq;
+
+static void put_le(unsigned char *p, unsigned int v, int n)
+{
+	while (n--)
+		*p++ = v, v >>= 8;
+}
+
+static void wav_header(FILE *f, int rate, int channels, unsigned int bytes)
+{
+	unsigned char hdr[44];
+
+	memcpy(hdr, "RIFF", 4);
+	put_le(hdr+4, 36 + bytes, 4);
+	memcpy(hdr+8, "WAVEfmt ", 8);
+	put_le(hdr+16, 16, 4);
+	put_le(hdr+20, 1, 2);		// PCM
+	put_le(hdr+22, channels, 2);
+	put_le(hdr+24, rate, 4);
+	put_le(hdr+28, rate * channels * 2, 4);
+	put_le(hdr+32, channels * 2, 2);
+	put_le(hdr+34, 16, 2);
+	memcpy(hdr+36, "data", 4);
+	put_le(hdr+40, bytes, 4);
+
+	fseek(f, 0, SEEK_SET);
+	fwrite(hdr, 1, sizeof(hdr), f);
+}
+
+// position the reference file at the start of its sample data
+static int wav_skip_header(FILE *f)
+{
+	unsigned char chunk[8];
+	unsigned int len;
+
+	if (fseek(f, 12, SEEK_SET) != 0)
+		return -1;
+	while (fread(chunk, 1, 8, f) == 8) {
+		len = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | (chunk[7] << 24);
+		if (memcmp(chunk, "data", 4) == 0)
+			return 0;
+		if (fseek(f, (len + 1) & ~1, SEEK_CUR) != 0)
+			break;
+	}
+	return -1;
+}
+
+static void snd_write(int len)
+{
+	short ref[sizeof(snd_buf) / 2];
+	int i, n, d;
+
+	snd_crc = crc32(snd_crc, (void *)PicoIn.sndOut, len);
+	data_bytes += len;
+	if (wav_out != NULL)
+		fwrite(PicoIn.sndOut, 1, len, wav_out);
+
+	if (wav_ref != NULL) {
+		n = fread(ref, 2, len / 2, wav_ref);
+		cmp_missing += len / 2 - n;
+		for (i = 0; i < n; i++) {
+			d = abs(PicoIn.sndOut[i] - ref[i]);
+			if (d > cmp_max)
+				cmp_max = d;
+			cmp_sq += (double)d * d;
+		}
+		cmp_samples += n;
+	}
+}
+
+static void usage(const char *argv0)
+{
+	printf("usage: %s [options] <file.vgm>\n"
+		"  -r rate     output sample rate (44100)\n"
+		"  -m          mono output\n"
+		"  -f          resample FM with the polyphase FIR filter\n"
+		"  -y          YM2612 instead of YM3438 emulation\n"
+		"  -s          disable SSG-EG\n"
+		"  -l seconds  maximum length to render (600)\n"
+		"  -o out.wav  write the rendered output\n"
+		"  -c ref.wav  compare the output with a wav rendered earlier\n"
+		"  -v          verbose\n", argv0);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *out_name = NULL, *ref_name = NULL;
+	int rate = 44100, max_secs = 600, frames = 0, fps;
+	unsigned int opt = POPT_EN_STEREO|POPT_EN_FM|POPT_EN_PSG|POPT_EN_YM2413
+		| POPT_EN_MCD_PCM;
+	double t0, secs, audio_secs;
+	int c;
+
+	while ((c = getopt(argc, argv, "r:mfysl:o:c:v")) != -1) {
+		switch (c) {
+		case 'r': rate = atoi(optarg); break;
+		case 'm': opt &= ~POPT_EN_STEREO; break;
+		case 'f': opt |= POPT_EN_FM_FILTER; break;
+		case 'y': opt |= POPT_FM_YM2612; break;
+		case 's': opt |= POPT_DIS_FM_SSGEG; break;
+		case 'l': max_secs = atoi(optarg); break;
+		case 'o': out_name = optarg; break;
+		case 'c': ref_name = optarg; break;
+		case 'v': hl_verbose = 1; break;
+		default:  usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	PicoIn.opt = opt;
+	PicoIn.sndRate = rate;
+	PicoInit();
+	if (PicoLoadMedia(argv[optind], NULL, 0, NULL, NULL, NULL, NULL) != PM_VGM) {
+		fprintf(stderr, "%s: can't load vgm\n", argv[optind]);
+		return 1;
+	}
+	PicoLoopPrepare();
+	PicoIn.writeSound = snd_write;
+	PicoIn.sndOut = snd_buf;
+	PsndRerate(0);
+
+	if (out_name != NULL) {
+		wav_out = fopen(out_name, "wb");
+		if (wav_out == NULL) {
+			fprintf(stderr, "can't write %s\n", out_name);
+			return 1;
+		}
+		wav_header(wav_out, rate, (opt & POPT_EN_STEREO) ? 2 : 1, 0);
+	}
+	if (ref_name != NULL) {
+		wav_ref = fopen(ref_name, "rb");
+		if (wav_ref == NULL || wav_skip_header(wav_ref) != 0) {
+			fprintf(stderr, "can't read %s\n", ref_name);
+			return 1;
+		}
+	}
+
+	fps = Pico.m.pal ? 50 : 60;
+	t0 = hl_time();
+	while (!vgm_done() && frames < max_secs * fps) {
+		PicoFrame();
+		frames++;
+	}
+	secs = hl_time() - t0;
+
+	audio_secs = (double)frames / fps;
+	printf("%s: %.1fs rendered in %.2fs (%.1fx realtime), crc %08x\n",
+		argv[optind], audio_secs, secs, secs > 0 ? audio_secs / secs : 0, snd_crc);
+
+	if (wav_ref != NULL) {
+		short dummy;
+		while (fread(&dummy, 2, 1, wav_ref) == 1)
+			cmp_missing++;
+		printf("vs %s: max diff %d, rms diff %.2f", ref_name, cmp_max,
+			cmp_samples ? sqrt(cmp_sq / cmp_samples) : 0);
+		if (cmp_missing)
+			printf(", %u samples not compared (length differs)", cmp_missing);
+		printf("\n");
+		fclose(wav_ref);
+	}
+	if (wav_out != NULL) {
+		wav_header(wav_out, rate, (opt & POPT_EN_STEREO) ? 2 : 1, data_bytes);
+		fclose(wav_out);
+	}
+
+	PicoExit();
+	return (wav_ref != NULL && (cmp_max != 0 || cmp_missing != 0)) ? 2 : 0;
+}
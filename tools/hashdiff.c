@@ -0,0 +1,72 @@
+/*
+ * compare two state hash logs written while replaying a movie with
+ * PICO_HASH_LOG=<file>, and report the 1st frame where they diverge.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#define COLS 6
+
+static const char *names[COLS] = {
+	"ram", "vram", "cram", "cpu", "sound", "screen"
+};
+
+static int read_line(FILE *f, unsigned int *frame, unsigned int *h)
+{
+	char buff[256];
+
+	while (fgets(buff, sizeof(buff), f) != NULL) {
+		if (buff[0] == '#')
+			continue;
+		if (sscanf(buff, "%u %x %x %x %x %x %x", frame,
+			   &h[0], &h[1], &h[2], &h[3], &h[4], &h[5]) == COLS+1)
+			return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int h1[COLS], h2[COLS], f1, f2;
+	int r1, r2, i, frames = 0;
+	FILE *l1, *l2;
+
+	if (argc != 3) {
+		printf("usage: %s <hash log> <hash log>\n", argv[0]);
+		return 1;
+	}
+
+	l1 = fopen(argv[1], "r");
+	l2 = fopen(argv[2], "r");
+	if (l1 == NULL || l2 == NULL) {
+		printf("can't open %s\n", l1 == NULL ? argv[1] : argv[2]);
+		return 1;
+	}
+
+	for (;;) {
+		r1 = read_line(l1, &f1, h1);
+		r2 = read_line(l2, &f2, h2);
+		if (!r1 || !r2)
+			break;
+		if (f1 != f2) {
+			printf("frame numbers differ: %u, %u\n", f1, f2);
+			return 2;
+		}
+		if (memcmp(h1, h2, sizeof(h1)) != 0) {
+			printf("frame %u differs:", f1);
+			for (i = 0; i < COLS; i++)
+				if (h1[i] != h2[i])
+					printf(" %s", names[i]);
+			printf("\n");
+			return 2;
+		}
+		frames++;
+	}
+
+	if (r1 != r2) {
+		printf("%s ends after %d frames\n", r1 ? argv[2] : argv[1], frames);
+		return 2;
+	}
+	printf("%d frames identical\n", frames);
+	return 0;
+}